@@ -0,0 +1,98 @@
+// Ingestion rate of IngestCorpus. Reads a corpus file, standard input for "-", or a synthetic Zipf corpus
+// formatted in memory. Prints one JSON object to stdout.
+// Build from this directory:
+//   g++ -std=c++17 -O2 -pthread -I.. ingestion_benchmark.cpp $(ls ../*.cpp | grep -v main.cpp) -ltbb
+// Run, every option is optional:
+//   ./a.out --input corpus.tsv --memory-budget-mb 512 --read-size-kb 1024
+//   ./a.out --documents 200000 --write corpus.tsv    writes the synthetic corpus and exits
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "corpus_ingestion.h"
+#include "synthetic_corpus.h"
+#include "trace_metrics.h"
+
+namespace {
+
+const char* const STATUS_NAMES[] = { "ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+
+void WriteCorpus(std::ostream& out, const SyntheticCorpus& corpus) {
+	const auto& documents = corpus.GetDocuments();
+	for (size_t i = 0; i < documents.size(); ++i) {
+		out << i << '\t' << STATUS_NAMES[i % 4] << '\t' << i % 10 << ' ' << i % 7 << '\t' << documents[i] << '\n';
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	CorpusConfig config;
+	config.document_count = 200'000;
+	config.query_count = 1;
+	IngestionOptions options;
+	std::string input_path;
+	std::string output_path;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string option = argv[i];
+		const char* value = argv[i + 1];
+		if (option == "--input") {
+			input_path = value;
+		}
+		else if (option == "--write") {
+			output_path = value;
+		}
+		else if (option == "--documents") {
+			config.document_count = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--memory-budget-mb") {
+			options.memory_budget = std::strtoull(value, nullptr, 10) << 20;
+		}
+		else if (option == "--read-size-kb") {
+			options.read_size = std::strtoull(value, nullptr, 10) << 10;
+		}
+		else {
+			std::cerr << "Unknown option " << option << std::endl;
+			return 1;
+		}
+	}
+
+	IngestionStats stats;
+	size_t index_memory_usage = 0;
+	try {
+		if (!input_path.empty()) {
+			SearchServer search_server(std::string{});
+			stats = IngestCorpus(search_server, input_path, options);
+			index_memory_usage = search_server.GetMemoryUsage();
+		}
+		else {
+			const SyntheticCorpus corpus(config);
+			if (!output_path.empty()) {
+				std::ofstream out(output_path, std::ios::binary);
+				WriteCorpus(out, corpus);
+				return out ? 0 : 1;
+			}
+			std::stringstream corpus_text;
+			WriteCorpus(corpus_text, corpus);
+			SearchServer search_server(corpus.GetStopWordsText());
+			stats = IngestCorpus(search_server, corpus_text, options);
+			index_memory_usage = search_server.GetMemoryUsage();
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	std::cerr << stats << std::endl;
+
+	std::cout << "{\"bytes\":" << stats.bytes_read << ",\"lines\":" << stats.lines_read
+		<< ",\"documents\":" << stats.added_count << ",\"errors\":" << stats.errors.size()
+		<< ",\"seconds\":" << stats.seconds << ",\"documents_per_sec\":" << stats.GetDocumentsPerSecond()
+		<< ",\"memory_budget_exceeded\":" << (stats.memory_budget_exceeded ? "true" : "false")
+		<< ",\"index_memory_bytes\":" << index_memory_usage << ",\n\"trace\":";
+	PrintTraceMetricsJson(std::cout);
+	std::cout << "}" << std::endl;
+}
@@ -0,0 +1,141 @@
+// Score accumulation kernels on posting lists of high-frequency terms, then end-to-end queries
+// that take the dense accumulation path.
+// Build from this directory:
+//   g++ -std=c++17 -O2 -pthread -I.. score_accumulation_benchmark.cpp $(ls ../*.cpp | grep -v main.cpp) -ltbb
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "score_accumulator.h"
+#include "search_server.h"
+
+namespace {
+
+const int ORDINAL_COUNT = 1'000'000;
+const int REPEAT_COUNT = 20;
+
+struct Postings {
+	std::vector<int> ordinals;
+	std::vector<double> term_freqs;
+};
+
+Postings MakePostings(double density, std::mt19937& generator) {
+	std::bernoulli_distribution contains(density);
+	std::uniform_real_distribution<double> term_freq(0.01, 0.5);
+	Postings postings;
+	for (int ordinal = 0; ordinal < ORDINAL_COUNT; ++ordinal) {
+		if (contains(generator)) {
+			postings.ordinals.push_back(ordinal);
+			postings.term_freqs.push_back(term_freq(generator));
+		}
+	}
+	return postings;
+}
+
+template <typename Kernel>
+double MeasureKernel(Kernel kernel, const std::vector<Postings>& terms, std::vector<double>& scores) {
+	double best_ms = 1e18;
+	for (int repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+		std::fill(scores.begin(), scores.end(), 0.0);
+		const auto start = std::chrono::steady_clock::now();
+		for (const Postings& postings : terms) {
+			kernel(postings.ordinals.data(), postings.term_freqs.data(), postings.ordinals.size(), 1.5, scores.data(), 0);
+		}
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best_ms = std::min(best_ms, elapsed.count());
+	}
+	return best_ms;
+}
+
+// Sparse accumulation used for queries with few postings, as the baseline
+double MeasureMap(const std::vector<Postings>& terms) {
+	double best_ms = 1e18;
+	for (int repeat = 0; repeat < REPEAT_COUNT / 4; ++repeat) {
+		const auto start = std::chrono::steady_clock::now();
+		std::map<int, double> scores;
+		for (const Postings& postings : terms) {
+			for (size_t i = 0; i < postings.ordinals.size(); ++i) {
+				scores[postings.ordinals[i]] += postings.term_freqs[i] * 1.5;
+			}
+		}
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best_ms = std::min(best_ms, elapsed.count());
+	}
+	return best_ms;
+}
+
+void BenchmarkKernels() {
+	std::mt19937 generator(42);
+	for (const double density : { 0.5, 0.2, 0.05 }) {
+		const std::vector<Postings> terms = { MakePostings(density, generator), MakePostings(density, generator),
+			MakePostings(density, generator) };
+		std::vector<double> scalar_scores(ORDINAL_COUNT);
+		std::vector<double> avx2_scores(ORDINAL_COUNT);
+		const double map_ms = MeasureMap(terms);
+		const double scalar_ms = MeasureKernel(AddScoresScalar, terms, scalar_scores);
+		std::cout << "density " << density << ": map " << map_ms << " ms, dense scalar " << scalar_ms << " ms";
+		if (HasAvx2ScoreKernel()) {
+			const double avx2_ms = MeasureKernel(AddScoresAvx2, terms, avx2_scores);
+			double max_difference = 0.0;
+			for (int i = 0; i < ORDINAL_COUNT; ++i) {
+				max_difference = std::max(max_difference, std::abs(scalar_scores[i] - avx2_scores[i]));
+			}
+			std::cout << ", dense avx2 " << avx2_ms << " ms, avx2 over scalar " << scalar_ms / avx2_ms
+				<< ", max difference " << max_difference;
+		}
+		std::cout << std::endl;
+	}
+}
+
+void BenchmarkQueries() {
+	const int document_count = 200'000;
+	std::mt19937 generator(7);
+	std::uniform_int_distribution<int> rare_word(0, 20'000);
+	SearchServer search_server("and with"s);
+	std::vector<std::string> texts;
+	texts.reserve(document_count);
+	std::vector<DocumentInput> documents;
+	documents.reserve(document_count);
+	for (int id = 0; id < document_count; ++id) {
+		std::string text;
+		// common0 is in every second document, common1 in every fourth and so on
+		for (int level = 0; level < 4; ++level) {
+			if (id % (2 << level) == 0) {
+				text += "common" + std::to_string(level) + " ";
+			}
+		}
+		for (int i = 0; i < 8; ++i) {
+			text += "word" + std::to_string(rare_word(generator)) + " ";
+		}
+		texts.push_back(std::move(text));
+	}
+	for (int id = 0; id < document_count; ++id) {
+		documents.push_back({ id, texts[id], DocumentStatus::ACTUAL, { id % 10 } });
+	}
+	search_server.AddDocuments(documents);
+
+	for (const std::string& query : { "common0 common1 common2 common3"s, "common0 common1 -common3"s }) {
+		double best_ms = 1e18;
+		for (int repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+			const auto start = std::chrono::steady_clock::now();
+			search_server.FindTopDocuments(query, DocumentStatus::ACTUAL);
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			best_ms = std::min(best_ms, elapsed.count());
+		}
+		std::cout << "query \"" << query << "\" over " << document_count << " documents: " << best_ms << " ms"
+			<< std::endl;
+	}
+}
+
+}  // namespace
+
+int main() {
+	std::cout << "AVX2 kernel " << (HasAvx2ScoreKernel() ? "available" : "unavailable") << std::endl;
+	BenchmarkKernels();
+	BenchmarkQueries();
+}
@@ -0,0 +1,258 @@
+// Throughput, latency and memory of the main SearchServer operations on a synthetic Zipf corpus.
+// Prints one JSON object to stdout, so runs can be compared by a script to gate regressions.
+// Build from this directory:
+//   g++ -std=c++17 -O2 -pthread -I.. search_server_benchmark.cpp $(ls ../*.cpp | grep -v main.cpp) -ltbb
+// Run, every option is optional:
+//   ./a.out --documents 50000 --vocabulary 50000 --length 100 --stop-ratio 0.3 --zipf 1.0 --queries 10000 --seed 42
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <execution>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "synthetic_corpus.h"
+#include "trace_metrics.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t QUERY_BATCH_SIZE = 100;
+const size_t PAGE_SIZE = 10;
+const size_t PAGE_COUNT = 10;
+const size_t SHARD_COUNT = 4;
+
+struct BenchmarkResult {
+	std::string name;
+	size_t operations = 0;
+	double seconds = 0.0;
+	// Per operation, empty if only the total time is measured
+	std::vector<double> latencies_us;
+	long peak_rss_kb = 0;
+};
+
+long GetPeakRssKb() {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+double GetQuantile(std::vector<double> values, double quantile) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	const size_t position = std::min(values.size() - 1, static_cast<size_t>(quantile * values.size()));
+	std::nth_element(values.begin(), values.begin() + position, values.end());
+	return values[position];
+}
+
+// Calls operation(i) for i in [0, count) and times every call
+template <typename Operation>
+BenchmarkResult MeasureEach(const std::string& name, size_t count, Operation operation) {
+	BenchmarkResult result;
+	result.name = name;
+	result.operations = count;
+	result.latencies_us.reserve(count);
+	const auto start = Clock::now();
+	for (size_t i = 0; i < count; ++i) {
+		const auto operation_start = Clock::now();
+		operation(i);
+		result.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - operation_start).count());
+	}
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.peak_rss_kb = GetPeakRssKb();
+	return result;
+}
+
+// Times operation() as a whole that performs count operations
+template <typename Operation>
+BenchmarkResult MeasureTotal(const std::string& name, size_t count, Operation operation) {
+	BenchmarkResult result;
+	result.name = name;
+	result.operations = count;
+	const auto start = Clock::now();
+	operation();
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.peak_rss_kb = GetPeakRssKb();
+	return result;
+}
+
+void PrintResult(std::ostream& out, const BenchmarkResult& result) {
+	out << "{\"name\":\"" << result.name << "\",\"operations\":" << result.operations
+		<< ",\"seconds\":" << result.seconds
+		<< ",\"ops_per_sec\":" << (result.seconds > 0.0 ? result.operations / result.seconds : 0.0);
+	if (!result.latencies_us.empty()) {
+		out << ",\"p50_us\":" << GetQuantile(result.latencies_us, 0.5)
+			<< ",\"p99_us\":" << GetQuantile(result.latencies_us, 0.99);
+	}
+	out << ",\"peak_rss_kb\":" << result.peak_rss_kb << '}';
+}
+
+CorpusConfig ParseArguments(int argc, char* argv[]) {
+	CorpusConfig config;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string option = argv[i];
+		const char* value = argv[i + 1];
+		if (option == "--documents") {
+			config.document_count = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--vocabulary") {
+			config.vocabulary_size = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--length") {
+			config.average_document_length = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--stop-ratio") {
+			config.stop_word_ratio = std::strtod(value, nullptr);
+		}
+		else if (option == "--zipf") {
+			config.zipf_exponent = std::strtod(value, nullptr);
+		}
+		else if (option == "--queries") {
+			config.query_count = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--seed") {
+			config.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		}
+		else {
+			throw std::invalid_argument("Unknown option " + option);
+		}
+	}
+	if (config.document_count == 0 || config.vocabulary_size == 0 || config.query_count == 0) {
+		throw std::invalid_argument("Document, vocabulary and query counts must be positive");
+	}
+	return config;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	CorpusConfig config;
+	try {
+		config = ParseArguments(argc, argv);
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	const SyntheticCorpus corpus(config);
+	const auto& documents = corpus.GetDocuments();
+	const auto& queries = corpus.GetQueries();
+	const auto status_of = [](size_t i) {
+		return static_cast<DocumentStatus>(i % 4);
+	};
+	std::vector<BenchmarkResult> results;
+
+	SearchServer search_server(corpus.GetStopWordsText());
+	results.push_back(MeasureEach("AddDocument", documents.size(), [&](size_t i) {
+		search_server.AddDocument(static_cast<int>(i), documents[i], status_of(i), { static_cast<int>(i % 10) });
+		}));
+
+	ShardedSearchServer sharded_server(corpus.GetStopWordsText(), SHARD_COUNT);
+	{
+		std::vector<DocumentInput> inputs;
+		for (size_t i = 0; i < documents.size(); ++i) {
+			inputs.push_back({ static_cast<int>(i), documents[i], status_of(i), { static_cast<int>(i % 10) } });
+		}
+		SearchServer bulk_server(corpus.GetStopWordsText());
+		results.push_back(MeasureTotal("AddDocuments", documents.size(), [&] {
+			bulk_server.AddDocuments(inputs);
+			}));
+		results.push_back(MeasureTotal("AddDocuments/sharded", documents.size(), [&] {
+			sharded_server.AddDocuments(inputs);
+			}));
+	}
+
+	results.push_back(MeasureEach("FindTopDocuments/seq/status", queries.size(), [&](size_t i) {
+		search_server.FindTopDocuments(std::execution::seq, queries[i], DocumentStatus::ACTUAL);
+		}));
+	results.push_back(MeasureEach("FindTopDocuments/seq/predicate", queries.size(), [&](size_t i) {
+		search_server.FindTopDocuments(std::execution::seq, queries[i], [](int document_id, DocumentStatus, int rating) {
+			return document_id % 2 == 0 && rating > 2;
+			});
+		}));
+	results.push_back(MeasureEach("FindTopDocuments/par/status", queries.size(), [&](size_t i) {
+		search_server.FindTopDocuments(std::execution::par, queries[i], DocumentStatus::ACTUAL);
+		}));
+	results.push_back(MeasureEach("FindTopDocuments/sharded/status", queries.size(), [&](size_t i) {
+		sharded_server.FindTopDocuments(queries[i], DocumentStatus::ACTUAL);
+		}));
+	// The page after PAGE_COUNT pages of PAGE_SIZE, by number and by cursor
+	{
+		std::vector<DocumentPage> previous_pages;
+		for (const std::string& query : queries) {
+			previous_pages.push_back(search_server.FindTopDocumentsPage(query, PAGE_COUNT - 1, PAGE_SIZE));
+		}
+		results.push_back(MeasureEach("FindTopDocumentsPage/number", queries.size(), [&](size_t i) {
+			search_server.FindTopDocumentsPage(queries[i], PAGE_COUNT, PAGE_SIZE);
+			}));
+		results.push_back(MeasureEach("FindTopDocumentsPage/cursor", queries.size(), [&](size_t i) {
+			if (previous_pages[i].next) {
+				search_server.FindTopDocumentsPage(queries[i], *previous_pages[i].next, PAGE_SIZE);
+			}
+			}));
+	}
+	results.push_back(MeasureEach("MatchDocument/seq", queries.size(), [&](size_t i) {
+		search_server.MatchDocument(std::execution::seq, queries[i], static_cast<int>(i * 7919 % documents.size()));
+		}));
+	results.push_back(MeasureEach("MatchDocument/par", queries.size(), [&](size_t i) {
+		search_server.MatchDocument(std::execution::par, queries[i], static_cast<int>(i * 7919 % documents.size()));
+		}));
+	// Every call matches the whole corpus, so a small share of the queries is enough
+	results.push_back(MeasureEach("MatchAllDocuments", std::min<size_t>(queries.size(), 100), [&](size_t i) {
+		search_server.MatchAllDocuments(queries[i]);
+		}));
+	{
+		std::vector<std::vector<std::string>> batches;
+		for (size_t i = 0; i < queries.size(); i += QUERY_BATCH_SIZE) {
+			batches.emplace_back(queries.begin() + i, queries.begin() + std::min(queries.size(), i + QUERY_BATCH_SIZE));
+		}
+		BenchmarkResult batch_result = MeasureEach("ProcessQueries", batches.size(), [&](size_t i) {
+			ProcessQueries(search_server, batches[i]);
+			});
+		// Throughput in queries, latency per batch
+		batch_result.operations = queries.size();
+		results.push_back(std::move(batch_result));
+	}
+
+	{
+		SearchServer removal_server = search_server;
+		const size_t removal_count = documents.size() / 10;
+		results.push_back(MeasureEach("RemoveDocument", removal_count, [&](size_t i) {
+			removal_server.RemoveDocument(static_cast<int>(i * 10));
+			}));
+	}
+	{
+		SearchServer deduplicated_server = search_server;
+		// Every removed duplicate is reported to cerr, the report is collected aside to keep the log readable
+		std::ostringstream removal_report;
+		std::streambuf* const output = std::cerr.rdbuf(removal_report.rdbuf());
+		results.push_back(MeasureTotal("RemoveDuplicates", documents.size(), [&] {
+			RemoveDuplicates(deduplicated_server);
+			}));
+		std::cerr.rdbuf(output);
+	}
+
+	std::cout << "{\"config\":{\"documents\":" << config.document_count << ",\"vocabulary\":" << config.vocabulary_size
+		<< ",\"average_length\":" << config.average_document_length << ",\"stop_word_ratio\":" << config.stop_word_ratio
+		<< ",\"zipf_exponent\":" << config.zipf_exponent << ",\"queries\":" << config.query_count
+		<< ",\"seed\":" << config.seed << "},\n\"results\":[\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		PrintResult(std::cout, results[i]);
+		std::cout << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	std::cout << "],\n\"peak_rss_kb\":" << GetPeakRssKb() << ",\n\"trace\":";
+	PrintTraceMetricsJson(std::cout);
+	std::cout << "}" << std::endl;
+}
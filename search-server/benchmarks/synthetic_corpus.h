@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+struct CorpusConfig {
+	size_t document_count = 50'000;
+	size_t vocabulary_size = 50'000;
+	// Document lengths are uniform in [average / 2, average * 3 / 2]
+	size_t average_document_length = 100;
+	// Share of stop words among the words of documents and queries
+	double stop_word_ratio = 0.3;
+	size_t stop_word_count = 30;
+	// Word of rank r is drawn with probability proportional to 1 / r^zipf_exponent
+	double zipf_exponent = 1.0;
+	// Share of documents that copy the words of an earlier document in another order
+	double duplicate_ratio = 0.02;
+	size_t query_count = 10'000;
+	size_t max_query_words = 4;
+	double minus_word_probability = 0.2;
+	uint32_t seed = 42;
+};
+
+// Deterministic corpus and queries with Zipf-distributed words, the same config gives the same texts
+class SyntheticCorpus {
+public:
+	explicit SyntheticCorpus(const CorpusConfig& config)
+		: config_(config)
+		, generator_(config.seed) {
+		for (size_t rank = 0; rank < config.vocabulary_size; ++rank) {
+			words_.push_back(MakeWord("w", rank));
+		}
+		for (size_t i = 0; i < config.stop_word_count; ++i) {
+			stop_words_.push_back(MakeWord("s", i));
+		}
+		double total = 0.0;
+		for (size_t rank = 1; rank <= config.vocabulary_size; ++rank) {
+			total += 1.0 / std::pow(static_cast<double>(rank), config.zipf_exponent);
+			cumulative_weights_.push_back(total);
+		}
+		GenerateDocuments();
+		GenerateQueries();
+	}
+
+	std::string GetStopWordsText() const {
+		std::string text;
+		for (const std::string& word : stop_words_) {
+			text += word + ' ';
+		}
+		return text;
+	}
+
+	const std::vector<std::string>& GetDocuments() const {
+		return documents_;
+	}
+
+	const std::vector<std::string>& GetQueries() const {
+		return queries_;
+	}
+
+private:
+	CorpusConfig config_;
+	std::mt19937 generator_;
+	std::vector<std::string> words_;
+	std::vector<std::string> stop_words_;
+	std::vector<double> cumulative_weights_;
+	std::vector<std::string> documents_;
+	std::vector<std::string> queries_;
+
+	// Letters spell the number, so words have different lengths and no common suffix
+	static std::string MakeWord(const std::string& prefix, size_t number) {
+		std::string word = prefix;
+		do {
+			word += static_cast<char>('a' + number % 26);
+			number /= 26;
+		} while (number > 0);
+		return word;
+	}
+
+	const std::string& DrawWord() {
+		if (std::bernoulli_distribution(config_.stop_word_ratio)(generator_) && !stop_words_.empty()) {
+			return stop_words_[std::uniform_int_distribution<size_t>(0, stop_words_.size() - 1)(generator_)];
+		}
+		const double point = std::uniform_real_distribution<double>(0.0, cumulative_weights_.back())(generator_);
+		const size_t rank = std::lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point)
+			- cumulative_weights_.begin();
+		return words_[std::min(rank, words_.size() - 1)];
+	}
+
+	void GenerateDocuments() {
+		std::uniform_int_distribution<size_t> length(std::max<size_t>(config_.average_document_length / 2, 1),
+			config_.average_document_length * 3 / 2);
+		std::bernoulli_distribution is_duplicate(config_.duplicate_ratio);
+		for (size_t i = 0; i < config_.document_count; ++i) {
+			if (!documents_.empty() && is_duplicate(generator_)) {
+				const std::string& original = documents_[std::uniform_int_distribution<size_t>(
+					0, documents_.size() - 1)(generator_)];
+				documents_.push_back(Reverse(original));
+				continue;
+			}
+			std::string text;
+			for (size_t j = length(generator_); j > 0; --j) {
+				text += DrawWord();
+				text += ' ';
+			}
+			documents_.push_back(std::move(text));
+		}
+	}
+
+	void GenerateQueries() {
+		std::uniform_int_distribution<size_t> word_count(1, std::max<size_t>(config_.max_query_words, 1));
+		std::bernoulli_distribution has_minus_word(config_.minus_word_probability);
+		for (size_t i = 0; i < config_.query_count; ++i) {
+			std::string query;
+			for (size_t j = word_count(generator_); j > 0; --j) {
+				query += DrawWord();
+				query += ' ';
+			}
+			if (has_minus_word(generator_)) {
+				query += '-';
+				query += DrawWord();
+			}
+			queries_.push_back(std::move(query));
+		}
+	}
+
+	// Same words in reverse order
+	static std::string Reverse(const std::string& text) {
+		std::vector<std::string> words;
+		std::string word;
+		for (const char c : text) {
+			if (c == ' ') {
+				if (!word.empty()) {
+					words.push_back(std::move(word));
+				}
+				word.clear();
+			}
+			else {
+				word += c;
+			}
+		}
+		if (!word.empty()) {
+			words.push_back(std::move(word));
+		}
+		std::string result;
+		for (auto it = words.rbegin(); it != words.rend(); ++it) {
+			result += *it + ' ';
+		}
+		return result;
+	}
+};
@@ -0,0 +1,135 @@
+#include "compressed_posting_list.h"
+
+#include <algorithm>
+
+namespace {
+
+uint8_t GetBitWidth(uint32_t value) {
+	uint8_t bits = 0;
+	for (; value != 0; value >>= 1) {
+		++bits;
+	}
+	return bits;
+}
+
+void PackBits(const uint32_t* values, size_t count, uint8_t bits, std::vector<uint32_t>& words) {
+	if (bits == 0) {
+		return;
+	}
+	uint64_t buffer = 0;
+	uint8_t buffered_bits = 0;
+	for (size_t i = 0; i < count; ++i) {
+		buffer |= static_cast<uint64_t>(values[i]) << buffered_bits;
+		buffered_bits += bits;
+		if (buffered_bits >= 32) {
+			words.push_back(static_cast<uint32_t>(buffer));
+			buffer >>= 32;
+			buffered_bits -= 32;
+		}
+	}
+	if (buffered_bits > 0) {
+		words.push_back(static_cast<uint32_t>(buffer));
+	}
+}
+
+// Returns the position after the unpacked words
+const uint32_t* UnpackBits(const uint32_t* words, size_t count, uint8_t bits, uint32_t* values) {
+	if (bits == 0) {
+		std::fill(values, values + count, 0);
+		return words;
+	}
+	const uint64_t mask = (uint64_t{ 1 } << bits) - 1;
+	uint64_t buffer = 0;
+	uint8_t buffered_bits = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (buffered_bits < bits) {
+			buffer |= static_cast<uint64_t>(*words++) << buffered_bits;
+			buffered_bits += 32;
+		}
+		values[i] = static_cast<uint32_t>(buffer & mask);
+		buffer >>= bits;
+		buffered_bits -= bits;
+	}
+	return words;
+}
+
+}  // namespace
+
+void CompressedPostingList::Append(int document, uint32_t count) {
+	tail_documents_.push_back(document);
+	tail_counts_.push_back(count);
+	++size_;
+	if (tail_documents_.size() == BLOCK_SIZE) {
+		blocks_.push_back(Encode(tail_documents_.data(), tail_counts_.data(), BLOCK_SIZE));
+		tail_documents_.clear();
+		tail_counts_.clear();
+		tail_documents_.shrink_to_fit();
+		tail_counts_.shrink_to_fit();
+	}
+}
+
+bool CompressedPostingList::Contains(int document) const {
+	if (!tail_documents_.empty() && tail_documents_.front() <= document) {
+		return std::binary_search(tail_documents_.begin(), tail_documents_.end(), document);
+	}
+	const auto block = FindBlock(document);
+	if (block == blocks_.end() || block->first_document > document) {
+		return false;
+	}
+	int documents[BLOCK_SIZE];
+	uint32_t counts[BLOCK_SIZE];
+	Decode(*block, documents, counts);
+	return std::binary_search(documents, documents + block->size, document);
+}
+
+size_t CompressedPostingList::GetMemoryUsage() const {
+	size_t memory_usage = sizeof(*this) + blocks_.capacity() * sizeof(Block)
+		+ tail_documents_.capacity() * sizeof(int) + tail_counts_.capacity() * sizeof(uint32_t);
+	for (const Block& block : blocks_) {
+		memory_usage += block.data.capacity() * sizeof(uint32_t);
+	}
+	return memory_usage;
+}
+
+CompressedPostingList::Block CompressedPostingList::Encode(const int* documents, const uint32_t* counts,
+	size_t size) {
+	uint32_t gaps[BLOCK_SIZE];
+	uint32_t stored_counts[BLOCK_SIZE];
+	uint32_t max_gap = 0;
+	uint32_t max_count = 0;
+	for (size_t i = 0; i < size; ++i) {
+		if (i > 0) {
+			gaps[i - 1] = static_cast<uint32_t>(documents[i] - documents[i - 1] - 1);
+			max_gap = std::max(max_gap, gaps[i - 1]);
+		}
+		stored_counts[i] = counts[i] - 1;
+		max_count = std::max(max_count, stored_counts[i]);
+	}
+
+	Block block{ documents[0], documents[size - 1], static_cast<uint16_t>(size), GetBitWidth(max_gap),
+		GetBitWidth(max_count), {} };
+	block.data.reserve(((size - 1) * block.gap_bits + size * block.count_bits) / 32 + 2);
+	PackBits(gaps, size - 1, block.gap_bits, block.data);
+	PackBits(stored_counts, size, block.count_bits, block.data);
+	block.data.shrink_to_fit();
+	return block;
+}
+
+void CompressedPostingList::Decode(const Block& block, int* documents, uint32_t* counts) {
+	uint32_t gaps[BLOCK_SIZE];
+	const uint32_t* words = UnpackBits(block.data.data(), block.size - 1, block.gap_bits, gaps);
+	UnpackBits(words, block.size, block.count_bits, counts);
+	documents[0] = block.first_document;
+	for (size_t i = 1; i < block.size; ++i) {
+		documents[i] = documents[i - 1] + static_cast<int>(gaps[i - 1]) + 1;
+	}
+	for (size_t i = 0; i < block.size; ++i) {
+		++counts[i];
+	}
+}
+
+std::vector<CompressedPostingList::Block>::const_iterator CompressedPostingList::FindBlock(int document) const {
+	return std::lower_bound(blocks_.begin(), blocks_.end(), document, [](const Block& block, int value) {
+		return block.last_document < value;
+		});
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Postings of one term in blocks of BLOCK_SIZE. A block keeps its first document number and the
+// bit-packed gaps between the following ones, with raw term counts bit-packed alongside. The block
+// headers double as skip pointers: a lookup decodes only the block that can hold the number.
+// Numbers must be appended in ascending order; the last, incomplete block stays unpacked.
+class CompressedPostingList {
+public:
+	static const size_t BLOCK_SIZE = 128;
+
+	void Append(int document, uint32_t count);
+
+	// Re-encodes the list without the postings whose document number satisfies is_removed
+	template <typename IsRemoved>
+	void RemoveIf(IsRemoved is_removed) {
+		CompressedPostingList kept;
+		ForEachBlock([&](const int* documents, const uint32_t* counts, size_t size) {
+			for (size_t i = 0; i < size; ++i) {
+				if (!is_removed(documents[i])) {
+					kept.Append(documents[i], counts[i]);
+				}
+			}
+			});
+		*this = std::move(kept);
+	}
+
+	bool Contains(int document) const;
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	// Calls visitor(documents, counts, size) for runs of at most BLOCK_SIZE postings in ascending order
+	template <typename Visitor>
+	void ForEachBlock(Visitor visitor) const {
+		int documents[BLOCK_SIZE];
+		uint32_t counts[BLOCK_SIZE];
+		for (const Block& block : blocks_) {
+			Decode(block, documents, counts);
+			visitor(static_cast<const int*>(documents), static_cast<const uint32_t*>(counts), block.size);
+		}
+		if (!tail_documents_.empty()) {
+			visitor(tail_documents_.data(), tail_counts_.data(), tail_documents_.size());
+		}
+	}
+
+	// Same for the postings with numbers in [first, last), blocks outside are skipped undecoded
+	template <typename Visitor>
+	void ForEachBlockInRange(int first, int last, Visitor visitor) const {
+		int documents[BLOCK_SIZE];
+		uint32_t counts[BLOCK_SIZE];
+		for (auto block = FindBlock(first); block != blocks_.end() && block->first_document < last; ++block) {
+			Decode(*block, documents, counts);
+			const int* const begin = std::lower_bound(documents, documents + block->size, first);
+			const int* const end = std::lower_bound(begin, static_cast<const int*>(documents + block->size), last);
+			visitor(begin, counts + (begin - documents), static_cast<size_t>(end - begin));
+		}
+		const auto begin = std::lower_bound(tail_documents_.begin(), tail_documents_.end(), first);
+		const auto end = std::lower_bound(begin, tail_documents_.end(), last);
+		if (begin != end) {
+			visitor(&*begin, tail_counts_.data() + (begin - tail_documents_.begin()), static_cast<size_t>(end - begin));
+		}
+	}
+
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Block {
+		int first_document;
+		int last_document;
+		uint16_t size;
+		uint8_t gap_bits;
+		uint8_t count_bits;
+		// size - 1 gaps minus one, then size counts minus one
+		std::vector<uint32_t> data;
+	};
+
+	std::vector<Block> blocks_;
+	std::vector<int> tail_documents_;
+	std::vector<uint32_t> tail_counts_;
+	size_t size_ = 0;
+
+	static Block Encode(const int* documents, const uint32_t* counts, size_t size);
+
+	static void Decode(const Block& block, int* documents, uint32_t* counts);
+
+	// First block whose last document is not less than document
+	std::vector<Block>::const_iterator FindBlock(int document) const;
+};
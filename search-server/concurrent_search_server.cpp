@@ -0,0 +1,22 @@
+#include "concurrent_search_server.h"
+
+ConcurrentSearchServer::ConcurrentSearchServer(std::string_view stop_words_text, size_t merge_factor)
+	: index_(stop_words_text, 1, merge_factor) {
+}
+
+uint64_t ConcurrentSearchServer::GetEpoch() const {
+	return index_.GetEpoch();
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	index_.AddDocument(document_id, document, status, ratings);
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+	index_.RemoveDocument(document_id);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+	return index_.GetDocumentCount();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "segmented_search_server.h"
+
+// SearchServer safe for concurrent queries and updates, every change is searchable once its call returns.
+// It is a SegmentedSearchServer whose write segment is sealed after every document: an update publishes a
+// version that shares all existing segments and adds only a one-document segment or one tombstone, and
+// background merges keep the number of segments logarithmic in the corpus size. A query pins the version
+// it started with, which is freed once the last query holding it finishes.
+class ConcurrentSearchServer {
+public:
+	explicit ConcurrentSearchServer(std::string_view stop_words_text, size_t merge_factor = DEFAULT_MERGE_FACTOR);
+
+	// Number of versions published so far, merges included
+	uint64_t GetEpoch() const;
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	template <typename... Args>
+	std::vector<Document> FindTopDocuments(Args&&... args) const {
+		return index_.FindTopDocuments(std::forward<Args>(args)...);
+	}
+
+	int GetDocumentCount() const;
+
+private:
+	SegmentedSearchServer index_;
+};
@@ -0,0 +1,347 @@
+#include "corpus_ingestion.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include "trace_metrics.h"
+
+namespace {
+
+// Push blocks while the queue is full, which holds back a stage running ahead of the next one
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity)
+		: capacity_(std::max<size_t>(capacity, 1)) {
+	}
+
+	// Returns false if the queue is closed, the item is dropped then
+	bool Push(T item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_full_.wait(lock, [this] {
+			return closed_ || items_.size() < capacity_;
+			});
+		if (closed_) {
+			return false;
+		}
+		items_.push_back(std::move(item));
+		not_empty_.notify_one();
+		return true;
+	}
+
+	// Returns nothing once the queue is closed and drained
+	std::optional<T> Pop() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_empty_.wait(lock, [this] {
+			return closed_ || !items_.empty();
+			});
+		if (items_.empty()) {
+			return std::nullopt;
+		}
+		T item = std::move(items_.front());
+		items_.pop_front();
+		not_full_.notify_one();
+		return item;
+	}
+
+	void Close() {
+		std::lock_guard<std::mutex> guard(mutex_);
+		closed_ = true;
+		not_full_.notify_all();
+		not_empty_.notify_all();
+	}
+
+private:
+	const size_t capacity_;
+	std::mutex mutex_;
+	std::condition_variable not_full_;
+	std::condition_variable not_empty_;
+	std::deque<T> items_;
+	bool closed_ = false;
+};
+
+// Moving a vector keeps its buffer, so the views into text stay valid as the chunk is passed on
+struct ParsedChunk {
+	std::vector<char> text;
+	std::vector<DocumentInput> documents;
+	std::vector<size_t> line_numbers;
+	std::vector<IngestionError> errors;
+};
+
+const std::array<std::string_view, DOCUMENT_STATUS_COUNT> DOCUMENT_STATUS_NAMES = {
+	"ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+
+std::string_view ReadField(std::string_view& line) {
+	const size_t tab = line.find('\t');
+	if (tab == std::string_view::npos) {
+		throw std::invalid_argument("Expected id, status, ratings and text separated by tabs");
+	}
+	const std::string_view field = line.substr(0, tab);
+	line.remove_prefix(tab + 1);
+	return field;
+}
+
+int ParseInt(std::string_view text) {
+	int value = 0;
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || error != std::errc() || end != text.data() + text.size()) {
+		throw std::invalid_argument("Invalid number " + std::string(text));
+	}
+	return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text) {
+	const auto name = std::find(DOCUMENT_STATUS_NAMES.begin(), DOCUMENT_STATUS_NAMES.end(), text);
+	if (name == DOCUMENT_STATUS_NAMES.end()) {
+		throw std::invalid_argument("Invalid status " + std::string(text));
+	}
+	return static_cast<DocumentStatus>(name - DOCUMENT_STATUS_NAMES.begin());
+}
+
+DocumentInput ParseDocument(std::string_view line) {
+	DocumentInput document{};
+	document.id = ParseInt(ReadField(line));
+	document.status = ParseStatus(ReadField(line));
+	std::string_view ratings = ReadField(line);
+	while (!ratings.empty()) {
+		const size_t space = std::min(ratings.find(' '), ratings.size());
+		if (space > 0) {
+			document.ratings.push_back(ParseInt(ratings.substr(0, space)));
+		}
+		ratings.remove_prefix(std::min(space + 1, ratings.size()));
+	}
+	document.text = line;
+	return document;
+}
+
+// line_number is the number of the line before the chunk and is advanced past it
+void ParseChunk(ParsedChunk& chunk, size_t& line_number) {
+	TRACE_SCOPE("ingest.parse");
+	const char* position = chunk.text.data();
+	const char* const end = position + chunk.text.size();
+	while (position < end) {
+		const char* const line_end = std::find(position, end, '\n');
+		std::string_view line(position, line_end - position);
+		position = line_end + (line_end < end ? 1 : 0);
+		++line_number;
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (line.empty()) {
+			continue;
+		}
+		try {
+			chunk.documents.push_back(ParseDocument(line));
+			chunk.line_numbers.push_back(line_number);
+		}
+		catch (const std::invalid_argument& e) {
+			chunk.errors.push_back({ line_number, e.what() });
+		}
+	}
+}
+
+// Splits the input into chunks of complete lines, a line longer than read_size makes its chunk longer
+void ReadChunks(std::istream& input, size_t read_size, BoundedQueue<std::vector<char>>& chunks, size_t& bytes_read) {
+	read_size = std::max<size_t>(read_size, 1);
+	std::vector<char> incomplete_line;
+	while (true) {
+		std::vector<char> text = std::move(incomplete_line);
+		incomplete_line.clear();
+		const size_t old_size = text.size();
+		text.resize(old_size + read_size);
+		input.read(text.data() + old_size, read_size);
+		if (input.bad()) {
+			throw std::runtime_error("Failed to read the corpus");
+		}
+		const size_t count = static_cast<size_t>(input.gcount());
+		text.resize(old_size + count);
+		bytes_read += count;
+		const bool at_end = count < read_size;
+		if (!at_end) {
+			const auto last_line_end = std::find(text.rbegin(), text.rend(), '\n');
+			if (last_line_end == text.rend()) {
+				incomplete_line = std::move(text);
+				continue;
+			}
+			incomplete_line.assign(last_line_end.base(), text.end());
+			text.erase(last_line_end.base(), text.end());
+		}
+		if (!text.empty() && !chunks.Push(std::move(text))) {
+			return;
+		}
+		if (at_end) {
+			return;
+		}
+	}
+}
+
+// SearchServer::GetMemoryUsage is linear in the index, so it is not called after every chunk. The usage is
+// extrapolated from the text indexed since the last measurement at the average rate measured so far, and
+// measured again once the estimate exceeds the budget or MEMORY_MEASUREMENT_INTERVAL chunks have passed.
+class MemoryBudget {
+public:
+	MemoryBudget(const SearchServer& search_server, size_t budget)
+		: search_server_(search_server)
+		, budget_(budget)
+		, initial_usage_(search_server.GetMemoryUsage())
+		, measured_usage_(initial_usage_) {
+	}
+
+	// Returns true once the index exceeds the budget
+	bool AddChunk(size_t text_size) {
+		indexed_bytes_ += text_size;
+		++unmeasured_chunks_;
+		const double estimate = measured_usage_ + (indexed_bytes_ - measured_bytes_) * usage_per_byte_;
+		if (usage_per_byte_ > 0.0 && estimate <= budget_ && unmeasured_chunks_ < MEMORY_MEASUREMENT_INTERVAL) {
+			return false;
+		}
+		measured_usage_ = search_server_.GetMemoryUsage();
+		measured_bytes_ = indexed_bytes_;
+		unmeasured_chunks_ = 0;
+		if (measured_usage_ > initial_usage_ && indexed_bytes_ > 0) {
+			usage_per_byte_ = static_cast<double>(measured_usage_ - initial_usage_) / indexed_bytes_;
+		}
+		return measured_usage_ > budget_;
+	}
+
+private:
+	const SearchServer& search_server_;
+	const size_t budget_;
+	const size_t initial_usage_;
+	size_t measured_usage_;
+	size_t indexed_bytes_ = 0;
+	size_t measured_bytes_ = 0;
+	size_t unmeasured_chunks_ = 0;
+	double usage_per_byte_ = 0.0;
+};
+
+void AppendErrors(const ParsedChunk& chunk, const AddDocumentsResult& result, std::vector<IngestionError>& errors) {
+	std::vector<IngestionError> index_errors;
+	for (const AddDocumentsResult::Error& error : result.errors) {
+		index_errors.push_back({ chunk.line_numbers[error.document_index], error.message });
+	}
+	std::merge(chunk.errors.begin(), chunk.errors.end(), index_errors.begin(), index_errors.end(),
+		std::back_inserter(errors), [](const IngestionError& lhs, const IngestionError& rhs) {
+			return lhs.line_number < rhs.line_number;
+		});
+}
+
+}  // namespace
+
+double IngestionStats::GetDocumentsPerSecond() const {
+	return seconds > 0.0 ? added_count / seconds : 0.0;
+}
+
+IngestionStats IngestCorpus(SearchServer& search_server, std::istream& input, const IngestionOptions& options) {
+	const auto start_time = std::chrono::steady_clock::now();
+	IngestionStats stats;
+	BoundedQueue<std::vector<char>> text_chunks(options.queue_capacity);
+	BoundedQueue<ParsedChunk> parsed_chunks(options.queue_capacity);
+
+	size_t bytes_read = 0;
+	std::exception_ptr reader_error;
+	std::thread reader([&] {
+		try {
+			ReadChunks(input, options.read_size, text_chunks, bytes_read);
+		}
+		catch (...) {
+			reader_error = std::current_exception();
+		}
+		text_chunks.Close();
+		});
+
+	size_t lines_read = 0;
+	std::exception_ptr parser_error;
+	std::thread parser([&] {
+		try {
+			while (auto text = text_chunks.Pop()) {
+				ParsedChunk chunk;
+				chunk.text = std::move(*text);
+				ParseChunk(chunk, lines_read);
+				if (!parsed_chunks.Push(std::move(chunk))) {
+					break;
+				}
+			}
+		}
+		catch (...) {
+			parser_error = std::current_exception();
+		}
+		// Stops the reader too if the indexer has stopped early
+		text_chunks.Close();
+		parsed_chunks.Close();
+		});
+
+	std::exception_ptr indexer_error;
+	try {
+		std::optional<MemoryBudget> memory_budget;
+		if (options.memory_budget > 0) {
+			memory_budget.emplace(search_server, options.memory_budget);
+		}
+		while (auto chunk = parsed_chunks.Pop()) {
+			if (!chunk->documents.empty()) {
+				TRACE_SCOPE("ingest.index");
+				const AddDocumentsResult result = search_server.AddDocuments(chunk->documents);
+				stats.added_count += result.added_count;
+				AppendErrors(*chunk, result, stats.errors);
+			}
+			else {
+				stats.errors.insert(stats.errors.end(), chunk->errors.begin(), chunk->errors.end());
+			}
+			if (memory_budget && memory_budget->AddChunk(chunk->text.size())) {
+				stats.memory_budget_exceeded = true;
+				break;
+			}
+		}
+	}
+	catch (...) {
+		indexer_error = std::current_exception();
+	}
+	parsed_chunks.Close();
+	text_chunks.Close();
+	parser.join();
+	reader.join();
+	for (const std::exception_ptr& error : { indexer_error, parser_error, reader_error }) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	stats.bytes_read = bytes_read;
+	stats.lines_read = lines_read;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	return stats;
+}
+
+IngestionStats IngestCorpus(SearchServer& search_server, const std::string& path, const IngestionOptions& options) {
+	if (path == "-") {
+		return IngestCorpus(search_server, std::cin, options);
+	}
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Failed to open " + path);
+	}
+	return IngestCorpus(search_server, input, options);
+}
+
+std::ostream& operator<<(std::ostream& out, const IngestionStats& stats) {
+	out << "Added " << stats.added_count << " documents of " << stats.lines_read << " lines, "
+		<< stats.bytes_read << " bytes in " << stats.seconds << " s: "
+		<< stats.GetDocumentsPerSecond() << " documents/s, " << stats.errors.size() << " errors";
+	if (stats.memory_budget_exceeded) {
+		out << ", stopped at the memory budget";
+	}
+	return out;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Corpus format: one document per line, four tab-separated fields
+//   id <TAB> status <TAB> ratings <TAB> text
+// status is ACTUAL, IRRELEVANT, BANNED or REMOVED, ratings are space-separated integers and may be empty.
+// Empty lines are skipped, a trailing '\r' is ignored.
+
+const size_t DEFAULT_INGESTION_READ_SIZE = 1 << 20;
+const size_t DEFAULT_INGESTION_QUEUE_CAPACITY = 4;
+// Chunks indexed at most between two measurements of the memory usage
+const size_t MEMORY_MEASUREMENT_INTERVAL = 64;
+
+struct IngestionOptions {
+	// Bytes per read, every chunk of complete lines is indexed by one AddDocuments
+	size_t read_size = DEFAULT_INGESTION_READ_SIZE;
+	// Chunks waiting between two stages. A full queue blocks the stage before it.
+	size_t queue_capacity = DEFAULT_INGESTION_QUEUE_CAPACITY;
+	// Ingestion stops once SearchServer::GetMemoryUsage exceeds it, 0 for no limit. The usage is measured
+	// when its estimate from the indexed text exceeds the budget and every MEMORY_MEASUREMENT_INTERVAL chunks.
+	size_t memory_budget = 0;
+};
+
+struct IngestionError {
+	// Numbered from 1
+	size_t line_number;
+	std::string message;
+};
+
+struct IngestionStats {
+	// Include what was read ahead of the indexer when ingestion stops early
+	size_t bytes_read = 0;
+	size_t lines_read = 0;
+	int added_count = 0;
+	// Malformed lines and rejected documents in input order
+	std::vector<IngestionError> errors;
+	double seconds = 0.0;
+	// The rest of the input is not read then
+	bool memory_budget_exceeded = false;
+
+	double GetDocumentsPerSecond() const;
+};
+
+// Reads the corpus in large chunks and runs reading, parsing and indexing on separate threads connected
+// by bounded queues. Documents of a chunk are added together, so the chunk that crosses the memory
+// budget is still indexed, and so are a few more if the index grows faster than its estimate.
+// Throws std::runtime_error if the input fails to be read.
+IngestionStats IngestCorpus(SearchServer& search_server, std::istream& input,
+	const IngestionOptions& options = {});
+
+// Reads standard input for the path "-". Throws std::runtime_error if the file cannot be opened.
+IngestionStats IngestCorpus(SearchServer& search_server, const std::string& path,
+	const IngestionOptions& options = {});
+
+std::ostream& operator<<(std::ostream& out, const IngestionStats& stats);
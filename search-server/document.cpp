@@ -28,12 +28,12 @@ void PrintDocument(const Document & document) {
 		<< "rating = "s << document.rating << " }"s << endl;
 }
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>&words, DocumentStatus status) {
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>&words, DocumentStatus status) {
 	cout << "{ "s
 		<< "document_id = "s << document_id << ", "s
 		<< "status = "s << static_cast<int>(status) << ", "s
 		<< "words ="s;
-	for (const std::string& word : words) {
+	for (const std::string_view word : words) {
 		cout << ' ' << word;
 	}
 	cout << "}"s << endl;
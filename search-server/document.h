@@ -1,4 +1,7 @@
 #pragma once
+#include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 struct Document {
@@ -21,5 +24,5 @@ std::ostream& operator<<(std::ostream& out, const Document& document);
 
 void PrintDocument(const Document& document);
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
 
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set of document ordinals, one bit per ordinal
+class DocumentBitset {
+public:
+	void Set(size_t ordinal) {
+		if (ordinal / WORD_BITS >= words_.size()) {
+			words_.resize(ordinal / WORD_BITS + 1);
+		}
+		words_[ordinal / WORD_BITS] |= uint64_t{ 1 } << (ordinal % WORD_BITS);
+	}
+
+	void Reset(size_t ordinal) {
+		if (ordinal / WORD_BITS < words_.size()) {
+			words_[ordinal / WORD_BITS] &= ~(uint64_t{ 1 } << (ordinal % WORD_BITS));
+		}
+	}
+
+	bool Test(size_t ordinal) const {
+		return ordinal / WORD_BITS < words_.size() && (words_[ordinal / WORD_BITS] >> (ordinal % WORD_BITS) & 1) != 0;
+	}
+
+	const std::vector<uint64_t>& GetWords() const {
+		return words_;
+	}
+
+private:
+	static const size_t WORD_BITS = 64;
+
+	std::vector<uint64_t> words_;
+};
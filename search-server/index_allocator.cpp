@@ -0,0 +1,7 @@
+#include "index_allocator.h"
+
+std::pmr::memory_resource* GetIndexMemoryResource() {
+	// Never destroyed, so indexes in static storage can release their nodes at any point of shutdown
+	static auto* const resource = new std::pmr::synchronized_pool_resource();
+	return resource;
+}
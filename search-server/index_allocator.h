@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <utility>
+
+// Pool shared by the node-based containers of all indexes. Nodes of one size are carved from common
+// chunks, so a long-running process that keeps adding and removing documents does not scatter them
+// over the heap. Freed nodes are reused by the pool rather than returned to the system.
+std::pmr::memory_resource* GetIndexMemoryResource();
+
+// Stateless allocator over GetIndexMemoryResource, so index containers keep plain copy and move semantics
+template <typename T>
+class IndexAllocator {
+public:
+	using value_type = T;
+
+	IndexAllocator() noexcept = default;
+
+	template <typename U>
+	IndexAllocator(const IndexAllocator<U>&) noexcept {
+	}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(GetIndexMemoryResource()->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, size_t count) noexcept {
+		GetIndexMemoryResource()->deallocate(pointer, count * sizeof(T), alignof(T));
+	}
+
+	template <typename U>
+	bool operator==(const IndexAllocator<U>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const IndexAllocator<U>&) const noexcept {
+		return false;
+	}
+};
+
+template <typename Key, typename Value>
+using IndexMap = std::map<Key, Value, std::less<Key>, IndexAllocator<std::pair<const Key, Value>>>;
@@ -13,20 +13,21 @@ using namespace literals;
 #define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
 #define LOG_DURATION_STREAM(x, y) LogDuration UNIQUE_VAR_NAME_PROFILE(x, y)
 
+// Prints the lifetime of a scope once, for ad hoc measurements. Use TRACE_SCOPE for code that runs often.
 class LogDuration {
 public:
 
-	LogDuration(const std::string& id, ostream& out) : id_(id), out_(std::cerr) {
+	explicit LogDuration(const std::string& id, ostream& out = std::cerr) : id_(id), out_(out) {
 	}
 
 	~LogDuration() {
 		const auto end_time = steady_clock::now();
 		const auto dur = end_time - start_time_;
-		cout << "Operation time" << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s << endl;
+		out_ << id_ << ": "s << duration_cast<microseconds>(dur).count() << " us"s << endl;
 	}
 
 private:
-	ostream& out_ = std::cerr;
-	const std::string id_ = "";
+	const std::string id_;
+	ostream& out_;
 	const steady_clock::time_point start_time_ = steady_clock::now();
 };
\ No newline at end of file
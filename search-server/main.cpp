@@ -2,6 +2,7 @@
 #include "request_queue.h"
 #include "paginator.h"
 #include "remove_duplicates.h"
+#include "test_example_functions.h"
 
 #include <locale.h>
 
@@ -10,6 +11,7 @@ using namespace std;
 
 int main() {
 	setlocale(LC_ALL, "Rus");
+	TestSearchServer();
 	SearchServer search_server("and with"s);
 
 	AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 
 template <typename Iterator>
 class IteratorRange {
@@ -7,7 +10,7 @@ public:
 	IteratorRange(Iterator begin, Iterator end)
 		: first_(begin)
 		, last_(end)
-		, size_(distance(first_, last_)) {
+		, size_(std::distance(first_, last_)) {
 	}
 	Iterator begin() const {
 		return first_;
@@ -31,29 +34,73 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
 	return out;
 }
 
+// Pages are computed on demand, so a paginator allocates nothing. Random-access iterators give
+// any page in O(1), other iterators are advanced page by page.
 template <typename Iterator>
 class Paginator {
 public:
-	Paginator(Iterator begin, Iterator end, size_t page_size) {
-		for (size_t left = distance(begin, end); left > 0;) {
-			const size_t current_page_size = std::min(page_size, left);
-			const Iterator current_page_end = next(begin, current_page_size);
-			pages_.push_back({ begin, current_page_end });
-			left -= current_page_size;
-			begin = current_page_end;
+	class PageIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = IteratorRange<Iterator>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		PageIterator(Iterator page_begin, size_t left, size_t page_size)
+			: page_begin_(page_begin)
+			, left_(left)
+			, page_size_(page_size) {
+		}
+
+		value_type operator*() const {
+			return { page_begin_, std::next(page_begin_, std::min(page_size_, left_)) };
+		}
+		PageIterator& operator++() {
+			const size_t current_page_size = std::min(page_size_, left_);
+			page_begin_ = std::next(page_begin_, current_page_size);
+			left_ -= current_page_size;
+			return *this;
+		}
+		bool operator==(const PageIterator& other) const {
+			return left_ == other.left_;
 		}
+		bool operator!=(const PageIterator& other) const {
+			return left_ != other.left_;
+		}
+
+	private:
+		Iterator page_begin_;
+		size_t left_;
+		size_t page_size_;
+	};
+
+	Paginator(Iterator begin, Iterator end, size_t page_size)
+		: begin_(begin)
+		, end_(end)
+		, item_count_(std::distance(begin, end))
+		, page_size_(std::max<size_t>(page_size, 1)) {
 	}
-	auto begin() const {
-		return pages_.begin();
+	PageIterator begin() const {
+		return PageIterator(begin_, item_count_, page_size_);
 	}
-	auto end() const {
-		return pages_.end();
+	PageIterator end() const {
+		return PageIterator(end_, 0, page_size_);
 	}
 	size_t size() const {
-		return pages_.size();
+		return (item_count_ + page_size_ - 1) / page_size_;
+	}
+	// index must be less than size()
+	IteratorRange<Iterator> operator[](size_t index) const {
+		const size_t first = index * page_size_;
+		const Iterator page_begin = std::next(begin_, first);
+		return { page_begin, std::next(page_begin, std::min(page_size_, item_count_ - first)) };
 	}
 private:
-	std::vector<IteratorRange<Iterator>> pages_;
+	Iterator begin_;
+	Iterator end_;
+	size_t item_count_;
+	size_t page_size_;
 };
 
 template <typename Container>
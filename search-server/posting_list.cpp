@@ -0,0 +1,40 @@
+#include "posting_list.h"
+
+PostingList::PostingList(std::vector<int> document_ids, std::vector<double> term_freqs, double max_term_freq)
+	: document_ids_(std::move(document_ids))
+	, term_freqs_(std::move(term_freqs))
+	, max_term_freq_(max_term_freq) {
+}
+
+void PostingList::Insert(int document_id, double term_freq) {
+	max_term_freq_ = std::max(max_term_freq_, term_freq);
+	if (document_ids_.empty() || document_ids_.back() < document_id) {
+		document_ids_.push_back(document_id);
+		term_freqs_.push_back(term_freq);
+		return;
+	}
+	const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+	const auto index = it - document_ids_.begin();
+	if (*it == document_id) {
+		term_freqs_[index] = term_freq;
+		return;
+	}
+	document_ids_.insert(it, document_id);
+	term_freqs_.insert(term_freqs_.begin() + index, term_freq);
+}
+
+bool PostingList::Contains(int document_id) const {
+	return std::binary_search(document_ids_.begin(), document_ids_.end(), document_id);
+}
+
+size_t GallopLowerBound(const std::vector<int>& ids, size_t from, int value) {
+	size_t step = 1;
+	size_t bound = from;
+	while (bound < ids.size() && ids[bound] < value) {
+		from = bound + 1;
+		bound += step;
+		step *= 2;
+	}
+	const auto last = ids.begin() + std::min(bound, ids.size());
+	return std::lower_bound(ids.begin() + std::min(from, ids.size()), last, value) - ids.begin();
+}
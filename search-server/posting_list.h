@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+// Postings of one term sorted by document number, numbers and term frequencies are kept in parallel arrays
+class PostingList {
+public:
+	PostingList() = default;
+
+	// Adopts ids sorted in ascending order together with their frequencies
+	PostingList(std::vector<int> document_ids, std::vector<double> term_freqs, double max_term_freq);
+
+	// Appending a document id greater than all stored ones is the fast path
+	void Insert(int document_id, double term_freq);
+
+	// Drops the postings whose document id satisfies is_removed in one pass over the list
+	template <typename IsRemoved>
+	void RemoveIf(IsRemoved is_removed) {
+		size_t kept = 0;
+		for (size_t i = 0; i < document_ids_.size(); ++i) {
+			if (!is_removed(document_ids_[i])) {
+				document_ids_[kept] = document_ids_[i];
+				term_freqs_[kept] = term_freqs_[i];
+				++kept;
+			}
+		}
+		document_ids_.resize(kept);
+		term_freqs_.resize(kept);
+	}
+
+	bool Contains(int document_id) const;
+
+	size_t size() const {
+		return document_ids_.size();
+	}
+
+	bool empty() const {
+		return document_ids_.empty();
+	}
+
+	const std::vector<int>& GetDocumentIds() const {
+		return document_ids_;
+	}
+
+	const std::vector<double>& GetTermFreqs() const {
+		return term_freqs_;
+	}
+
+	// Upper bound of the stored term frequencies, it is not lowered by RemoveIf
+	double GetMaxTermFreq() const {
+		return max_term_freq_;
+	}
+
+	size_t GetMemoryUsage() const {
+		return sizeof(*this) + document_ids_.capacity() * sizeof(int) + term_freqs_.capacity() * sizeof(double);
+	}
+
+private:
+	std::vector<int> document_ids_;
+	std::vector<double> term_freqs_;
+	double max_term_freq_ = 0.0;
+};
+
+// First position not less than value in sorted ids[from..], found by exponential then binary search
+size_t GallopLowerBound(const std::vector<int>& ids, size_t from, int value);
+
+// Removes items whose document id occurs in the sorted ids. Items must be sorted by document id.
+// Ids are galloped over because a posting list is usually much longer than the candidate list.
+template <typename Items, typename GetDocumentId>
+void EraseDocumentsIn(Items& items, const std::vector<int>& ids, GetDocumentId get_document_id) {
+	size_t position = 0;
+	const auto new_end = std::remove_if(items.begin(), items.end(), [&](const auto& item) {
+		const int document_id = get_document_id(item);
+		position = GallopLowerBound(ids, position, document_id);
+		return position < ids.size() && ids[position] == document_id;
+		});
+	items.erase(new_end, items.end());
+}
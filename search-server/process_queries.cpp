@@ -0,0 +1,103 @@
+#include "process_queries.h"
+
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <mutex>
+
+namespace {
+
+std::vector<std::vector<Document>> ProcessQueryRange(const SearchServer& search_server,
+	std::vector<std::string>::const_iterator first, std::vector<std::string>::const_iterator last) {
+	std::vector<std::vector<Document>> documents_lists(last - first);
+	// An exception escaping a parallel algorithm calls std::terminate, so the first one is rethrown here
+	std::exception_ptr first_error;
+	std::mutex error_mutex;
+	std::transform(std::execution::par, first, last, documents_lists.begin(),
+		[&](const std::string& query) -> std::vector<Document> {
+			try {
+				return search_server.FindTopDocuments(query, DocumentStatus::ACTUAL);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> guard(error_mutex);
+				if (!first_error) {
+					first_error = std::current_exception();
+				}
+				return {};
+			}
+		});
+	if (first_error) {
+		std::rethrow_exception(first_error);
+	}
+	return documents_lists;
+}
+
+}  // namespace
+
+JoinedDocuments::Iterator::Iterator(JoinedDocuments* documents)
+	: documents_(documents) {
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+	if (!documents_->Advance()) {
+		documents_ = nullptr;
+	}
+	return *this;
+}
+
+JoinedDocuments::JoinedDocuments(const SearchServer& search_server, std::vector<std::string> queries)
+	: search_server_(&search_server)
+	, queries_(std::move(queries)) {
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() {
+	next_query_ = 0;
+	chunk_.clear();
+	list_index_ = 0;
+	document_index_ = 0;
+	return SkipEmptyLists() ? Iterator(this) : end();
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() {
+	return Iterator();
+}
+
+const Document& JoinedDocuments::GetDocument() const {
+	return chunk_[list_index_][document_index_];
+}
+
+bool JoinedDocuments::Advance() {
+	++document_index_;
+	return SkipEmptyLists();
+}
+
+bool JoinedDocuments::SkipEmptyLists() {
+	while (list_index_ == chunk_.size() || document_index_ == chunk_[list_index_].size()) {
+		if (list_index_ < chunk_.size()) {
+			++list_index_;
+			document_index_ = 0;
+			continue;
+		}
+		if (next_query_ == queries_.size()) {
+			return false;
+		}
+		const size_t last_query = std::min(queries_.size(), next_query_ + JOINED_QUERIES_CHUNK_SIZE);
+		chunk_ = ProcessQueryRange(*search_server_, queries_.begin() + next_query_, queries_.begin() + last_query);
+		next_query_ = last_query;
+		list_index_ = 0;
+		document_index_ = 0;
+	}
+	return true;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries) {
+	return ProcessQueryRange(search_server, queries.begin(), queries.end());
+}
+
+JoinedDocuments ProcessQueriesJoined(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries) {
+	return JoinedDocuments(search_server, queries);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Queries of a joined batch run concurrently in chunks of this many
+const size_t JOINED_QUERIES_CHUNK_SIZE = 64;
+
+// Results of a query batch viewed as one flat sequence of documents. Queries run chunk by chunk as the
+// sequence is iterated, so only the results of one chunk are held at a time. The sequence is single-pass:
+// begin() starts from the first chunk. The queries are copied, the server must outlive the iteration.
+// An invalid query throws std::invalid_argument from the call that reaches its chunk.
+class JoinedDocuments {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Document;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Document*;
+		using reference = const Document&;
+
+		// The end iterator
+		Iterator() = default;
+		explicit Iterator(JoinedDocuments* documents);
+
+		reference operator*() const {
+			return documents_->GetDocument();
+		}
+		pointer operator->() const {
+			return &**this;
+		}
+		Iterator& operator++();
+
+		bool operator==(const Iterator& other) const {
+			return documents_ == other.documents_;
+		}
+		bool operator!=(const Iterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		// Null once the sequence is exhausted
+		JoinedDocuments* documents_ = nullptr;
+	};
+
+	JoinedDocuments(const SearchServer& search_server, std::vector<std::string> queries);
+
+	Iterator begin();
+	Iterator end();
+
+private:
+	const SearchServer* search_server_;
+	std::vector<std::string> queries_;
+	// First query of the next chunk
+	size_t next_query_ = 0;
+	std::vector<std::vector<Document>> chunk_;
+	size_t list_index_ = 0;
+	size_t document_index_ = 0;
+
+	const Document& GetDocument() const;
+
+	// Returns false at the end of the sequence
+	bool Advance();
+
+	// Moves to the next document, loading chunks past the empty result lists
+	bool SkipEmptyLists();
+};
+
+std::vector<std::vector<Document>> ProcessQueries(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries);
+
+JoinedDocuments ProcessQueriesJoined(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries);
@@ -0,0 +1,78 @@
+#include "query_result_cache.h"
+
+#include <functional>
+#include <stdexcept>
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, size_t capacity)
+	: search_server_(search_server)
+	, shard_capacity_((capacity + QUERY_CACHE_SHARD_COUNT - 1) / QUERY_CACHE_SHARD_COUNT)
+	, shards_(QUERY_CACHE_SHARD_COUNT) {
+	if (capacity == 0) {
+		throw std::invalid_argument("Query cache capacity must be positive");
+	}
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+	size_t result_count) {
+	std::string key = search_server_.NormalizeQuery(raw_query);
+	key.append("\n").append(std::to_string(static_cast<int>(status)))
+		.append("\n").append(std::to_string(result_count));
+	Shard& shard = GetShard(key);
+	const uint64_t generation = search_server_.GetGeneration();
+	{
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		const auto entry = shard.index.find(key);
+		if (entry != shard.index.end()) {
+			if (entry->second->generation == generation) {
+				shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+				++hit_count_;
+				return shard.entries.front().documents;
+			}
+			shard.entries.erase(entry->second);
+			shard.index.erase(entry);
+		}
+	}
+	++miss_count_;
+
+	// Searching is done unlocked, concurrent misses of one key compute it independently
+	auto documents = search_server_.FindTopDocuments(raw_query, status, result_count);
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	const auto entry = shard.index.find(key);
+	if (entry != shard.index.end()) {
+		entry->second->generation = generation;
+		entry->second->documents = documents;
+		shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+		return documents;
+	}
+	shard.entries.push_front({ std::move(key), generation, documents });
+	shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+	if (shard.entries.size() > shard_capacity_) {
+		shard.index.erase(shard.entries.back().key);
+		shard.entries.pop_back();
+	}
+	return documents;
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query) {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+uint64_t QueryResultCache::GetHitCount() const {
+	return hit_count_.load();
+}
+
+uint64_t QueryResultCache::GetMissCount() const {
+	return miss_count_.load();
+}
+
+void QueryResultCache::Clear() {
+	for (Shard& shard : shards_) {
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		shard.index.clear();
+		shard.entries.clear();
+	}
+}
+
+QueryResultCache::Shard& QueryResultCache::GetShard(std::string_view key) {
+	return shards_[std::hash<std::string_view>{}(key) % shards_.size()];
+}
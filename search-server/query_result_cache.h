@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+
+const size_t DEFAULT_QUERY_CACHE_CAPACITY = 4096;
+const size_t QUERY_CACHE_SHARD_COUNT = 16;
+
+// LRU cache of FindTopDocuments results for the status overloads, placed in front of a server.
+// Queries are keyed by their normalized words, status and result count, so word order, repeated
+// words and stop words do not split the key. An entry is valid while the server generation it was
+// computed at is current, a mutated server makes every older entry a miss.
+//
+// Lookups are sharded by key and may run concurrently, as long as the server is not mutated meanwhile.
+class QueryResultCache {
+public:
+	explicit QueryResultCache(const SearchServer& search_server, size_t capacity = DEFAULT_QUERY_CACHE_CAPACITY);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+	uint64_t GetHitCount() const;
+
+	uint64_t GetMissCount() const;
+
+	void Clear();
+
+private:
+	struct Entry {
+		std::string key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+
+	struct Shard {
+		std::mutex mutex;
+		// Most recently used first
+		std::list<Entry> entries;
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+	};
+
+	const SearchServer& search_server_;
+	const size_t shard_capacity_;
+	std::vector<Shard> shards_;
+	std::atomic<uint64_t> hit_count_ = 0;
+	std::atomic<uint64_t> miss_count_ = 0;
+
+	Shard& GetShard(std::string_view key);
+};
@@ -1,35 +1,189 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #include "remove_duplicates.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
 
-void RemoveDuplicates(SearchServer& search_server) {
-	LOG_DURATION_STREAM("RemoveDuplicates", cout);
-	set<int> duplicate;
-	map<set<std::string>, int> dmap;
-	set<string> temp_set;
+#include "trace_metrics.h"
+
+namespace {
+
+const size_t MINHASH_BAND_COUNT = 16;
+const size_t MINHASH_ROWS_PER_BAND = 4;
+const size_t MINHASH_SIZE = MINHASH_BAND_COUNT * MINHASH_ROWS_PER_BAND;
+
+using MinHashSignature = std::array<uint64_t, MINHASH_SIZE>;
+
+// 128-bit hash of a document's sorted term ids, equal word sets give equal fingerprints
+struct Fingerprint {
+	uint64_t high;
+	uint64_t low;
+
+	bool operator==(const Fingerprint& other) const {
+		return high == other.high && low == other.low;
+	}
+};
+
+struct FingerprintHasher {
+	size_t operator()(const Fingerprint& fingerprint) const {
+		return static_cast<size_t>(fingerprint.low ^ (fingerprint.high >> 1));
+	}
+};
+
+// splitmix64 finalizer
+uint64_t Mix(uint64_t value) {
+	value ^= value >> 30;
+	value *= 0xbf58476d1ce4e5b9ULL;
+	value ^= value >> 27;
+	value *= 0x94d049bb133111ebULL;
+	value ^= value >> 31;
+	return value;
+}
+
+Fingerprint ComputeFingerprint(const std::vector<TermId>& term_ids) {
+	Fingerprint fingerprint{ 0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL ^ term_ids.size() };
+	for (const TermId term_id : term_ids) {
+		fingerprint.high = Mix(fingerprint.high ^ term_id);
+		fingerprint.low = Mix(fingerprint.low + term_id * 0x9e3779b97f4a7c15ULL);
+	}
+	return fingerprint;
+}
+
+MinHashSignature ComputeMinHash(const std::vector<TermId>& term_ids) {
+	MinHashSignature signature;
+	signature.fill(UINT64_MAX);
+	for (const TermId term_id : term_ids) {
+		for (size_t i = 0; i < MINHASH_SIZE; ++i) {
+			signature[i] = std::min(signature[i], Mix(term_id + (i + 1) * 0x9e3779b97f4a7c15ULL));
+		}
+	}
+	return signature;
+}
 
-	for (auto st = search_server.begin(); st != search_server.end(); st++) {
-		int doc_id = st->first;
-		auto mymap = search_server.GetWordFrequencies(doc_id); // по id получили словарь первого документа
-		temp_set.clear();
-		for (auto ss = mymap.begin(); ss != mymap.end(); ss++) {
-			temp_set.insert(ss->first);
+uint64_t ComputeBandKey(const MinHashSignature& signature, size_t band) {
+	uint64_t key = band;
+	for (size_t row = 0; row < MINHASH_ROWS_PER_BAND; ++row) {
+		key = Mix(key ^ signature[band * MINHASH_ROWS_PER_BAND + row]);
+	}
+	return key;
+}
+
+// Term id lists are sorted and contain no repeats
+double ComputeJaccardSimilarity(const std::vector<TermId>& lhs, const std::vector<TermId>& rhs) {
+	if (lhs.empty() && rhs.empty()) {
+		return 1.0;
+	}
+	size_t common = 0;
+	for (size_t i = 0, j = 0; i < lhs.size() && j < rhs.size();) {
+		if (lhs[i] < rhs[j]) {
+			++i;
 		}
-		if (st == search_server.begin()) {
-			dmap[temp_set] = doc_id;
+		else if (rhs[j] < lhs[i]) {
+			++j;
 		}
 		else {
-			bool r = !dmap.count(temp_set) > 0;
-			if (r) {
-				dmap[temp_set] = doc_id;
-			}
-			else {
-				duplicate.insert(doc_id);
-			}
+			++common;
+			++i;
+			++j;
 		}
 	}
+	return static_cast<double>(common) / (lhs.size() + rhs.size() - common);
+}
+
+std::vector<int> CollectDocumentIds(const SearchServer& search_server) {
+	std::vector<int> document_ids;
+	document_ids.reserve(search_server.GetDocumentCount());
+	for (const auto& [document_id, _] : search_server) {
+		document_ids.push_back(document_id);
+	}
+	return document_ids;
+}
+
+void RemoveDocuments(SearchServer& search_server, const std::vector<int>& document_ids) {
+	for (const int document_id : document_ids) {
+		std::cerr << "Found duplicate document id " << document_id << std::endl;
+		search_server.RemoveDocument(document_id);
+	}
+}
+
+}  // namespace
+
+void RemoveDuplicates(SearchServer& search_server) {
+	TRACE_SCOPE("remove_duplicates");
+	const std::vector<int> document_ids = CollectDocumentIds(search_server);
+	std::vector<Fingerprint> fingerprints(document_ids.size());
+	std::transform(std::execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+		[&search_server](int document_id) {
+			return ComputeFingerprint(search_server.GetDocumentTermIds(document_id));
+		});
 
-	for (const int i : duplicate) {
-		search_server.RemoveDocument(i);
+	// Documents are visited in id order, so the one with the smallest id is kept
+	std::unordered_map<Fingerprint, std::vector<int>, FingerprintHasher> originals;
+	std::vector<int> duplicates;
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		const auto& term_ids = search_server.GetDocumentTermIds(document_ids[i]);
+		auto& same_fingerprint = originals[fingerprints[i]];
+		// fingerprints may collide, equal fingerprints are confirmed by comparing the words
+		const bool is_duplicate = std::any_of(same_fingerprint.begin(), same_fingerprint.end(),
+			[&](int original_id) {
+				return search_server.GetDocumentTermIds(original_id) == term_ids;
+			});
+		if (is_duplicate) {
+			duplicates.push_back(document_ids[i]);
+		}
+		else {
+			same_fingerprint.push_back(document_ids[i]);
+		}
+	}
+	RemoveDocuments(search_server, duplicates);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, double similarity_threshold) {
+	if (!(similarity_threshold > 0.0 && similarity_threshold <= 1.0)) {
+		throw std::invalid_argument("Similarity threshold must be in (0, 1]");
+	}
+	TRACE_SCOPE("remove_near_duplicates");
+	const std::vector<int> document_ids = CollectDocumentIds(search_server);
+	std::vector<MinHashSignature> signatures(document_ids.size());
+	std::transform(std::execution::par, document_ids.begin(), document_ids.end(), signatures.begin(),
+		[&search_server](int document_id) {
+			return ComputeMinHash(search_server.GetDocumentTermIds(document_id));
+		});
+
+	// Band buckets hold kept documents only, a candidate pair must agree on every row of some band
+	std::vector<std::unordered_map<uint64_t, std::vector<int>>> band_buckets(MINHASH_BAND_COUNT);
+	std::vector<int> duplicates;
+	std::vector<int> candidates;
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		std::array<uint64_t, MINHASH_BAND_COUNT> band_keys;
+		candidates.clear();
+		for (size_t band = 0; band < MINHASH_BAND_COUNT; ++band) {
+			band_keys[band] = ComputeBandKey(signatures[i], band);
+			const auto bucket = band_buckets[band].find(band_keys[band]);
+			if (bucket != band_buckets[band].end()) {
+				candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+		const auto& term_ids = search_server.GetDocumentTermIds(document_ids[i]);
+		const bool is_duplicate = std::any_of(candidates.begin(), candidates.end(), [&](int original_id) {
+			return ComputeJaccardSimilarity(search_server.GetDocumentTermIds(original_id), term_ids)
+				>= similarity_threshold;
+			});
+		if (is_duplicate) {
+			duplicates.push_back(document_ids[i]);
+			continue;
+		}
+		for (size_t band = 0; band < MINHASH_BAND_COUNT; ++band) {
+			band_buckets[band][band_keys[band]].push_back(document_ids[i]);
+		}
 	}
+	RemoveDocuments(search_server, duplicates);
 }
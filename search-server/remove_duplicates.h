@@ -4,4 +4,10 @@
 #include "log_duration.h"
 
 
+// Removes documents with exactly the same set of words as a document with a smaller id
 void RemoveDuplicates(SearchServer& search_server);
+
+// Removes documents whose word sets have Jaccard similarity of at least similarity_threshold with a kept
+// document with a smaller id. Candidates are found by banded MinHash signatures and checked exactly,
+// so rare pairs near the threshold may be missed.
+void RemoveNearDuplicates(SearchServer& search_server, double similarity_threshold);
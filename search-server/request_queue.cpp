@@ -3,34 +3,37 @@
 
 using namespace std;
 
-vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
+vector<Document> RequestQueue::AddFindRequest(string_view raw_query, DocumentStatus status) {
+	const auto start = RequestStatistics::Clock::now();
 	const auto result = search_server_.FindTopDocuments(raw_query, status);
-	AddRequest(result.size());
+	AddRequest(start, result.size());
 	return result;
 }
-vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
+vector<Document> RequestQueue::AddFindRequest(string_view raw_query) {
+	const auto start = RequestStatistics::Clock::now();
 	const auto result = search_server_.FindTopDocuments(raw_query);
-	AddRequest(result.size());
+	AddRequest(start, result.size());
 	return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-	return no_results_requests_;
-}
-
-void RequestQueue::AddRequest(int results_num) {
-	// новый запрос - новая секунда
-	++current_time_;
-	// удаляем все результаты поиска, которые устарели
-	while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-		if (0 == requests_.front().results) {
-			--no_results_requests_;
+	uint64_t no_results_requests = 0;
+	chrono::seconds longest_window(0);
+	for (size_t i = 0; i < statistics_.GetWindowCount(); ++i) {
+		const RequestWindowStats stats = statistics_.GetStats(i);
+		if (stats.window >= longest_window) {
+			longest_window = stats.window;
+			no_results_requests = stats.no_result_count;
 		}
-		requests_.pop_front();
-	}
-	// сохраняем новый результат поиска
-	requests_.push_back({ current_time_, results_num });
-	if (0 == results_num) {
-		++no_results_requests_;
 	}
+	return static_cast<int>(no_results_requests);
+}
+
+RequestWindowStats RequestQueue::GetStats(size_t window_index) const {
+	return statistics_.GetStats(window_index);
+}
+
+void RequestQueue::AddRequest(RequestStatistics::Clock::time_point start, size_t results_num) {
+	const auto finish = RequestStatistics::Clock::now();
+	statistics_.Record(finish, finish - start, results_num);
 }
@@ -1,40 +1,41 @@
 #pragma once
-#include <deque>
+#include <chrono>
+#include <vector>
 
 #include"search_server.h"
+#include "request_statistics.h"
 
+// Safe to use from several threads at once, statistics are updated without locks
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer& search_server)
+	explicit RequestQueue(const SearchServer& search_server, const std::vector<std::chrono::seconds>& windows = {
+		std::chrono::minutes(1), std::chrono::hours(1), std::chrono::hours(24) })
 		: search_server_(search_server)
-		, no_results_requests_(0)
-		, current_time_(0) {
+		, statistics_(windows) {
 	}
 
 	// сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
 	template <typename DocumentPredicate>
-	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+	std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
+		const auto start = RequestStatistics::Clock::now();
 		const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-		AddRequest(result.size());
+		AddRequest(start, result.size());
 		return result;
 	}
 
-	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
+	std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status);
 
-	std::vector<Document> AddFindRequest(const std::string& raw_query);
+	std::vector<Document> AddFindRequest(std::string_view raw_query);
 
+	// Requests without results in the longest window
 	int GetNoResultRequests() const;
 
+	// Statistics of the window with the given index in the constructor list
+	RequestWindowStats GetStats(size_t window_index) const;
+
 private:
-	struct QueryResult {
-		uint64_t timestamp;
-		int results;
-	};
-	std::deque<QueryResult> requests_;
 	const SearchServer& search_server_;
-	int no_results_requests_;
-	uint64_t current_time_;
-	const static int min_in_day_ = 1440;
+	RequestStatistics statistics_;
 
-	void AddRequest(int results_num);
+	void AddRequest(RequestStatistics::Clock::time_point start, size_t results_num);
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+std::chrono::microseconds RequestWindowStats::GetLatencyQuantile(double quantile) const {
+	if (request_count == 0) {
+		return std::chrono::microseconds(0);
+	}
+	const double rank = std::clamp(quantile, 0.0, 1.0) * request_count;
+	uint64_t count = 0;
+	for (size_t i = 0; i + 1 < latency_histogram.size(); ++i) {
+		count += latency_histogram[i];
+		if (count > 0 && count >= rank) {
+			return std::chrono::microseconds(uint64_t{ 1 } << i);
+		}
+	}
+	return std::chrono::microseconds(uint64_t{ 1 } << (latency_histogram.size() - 1));
+}
+
+RequestStatistics::RequestStatistics(const std::vector<std::chrono::seconds>& windows)
+	: origin_(Clock::now()) {
+	for (const std::chrono::seconds length : windows) {
+		const Clock::duration bucket_length = std::chrono::duration_cast<Clock::duration>(length) / WINDOW_BUCKET_COUNT;
+		if (bucket_length <= Clock::duration::zero()) {
+			throw std::invalid_argument("Statistics window is too short");
+		}
+		windows_.push_back({ length, bucket_length, std::make_unique<Bucket[]>(WINDOW_BUCKET_COUNT) });
+	}
+}
+
+void RequestStatistics::Record(Clock::time_point time, Clock::duration latency, size_t result_count) {
+	const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+	size_t latency_bucket = 0;
+	for (auto value = microseconds; value > 0 && latency_bucket + 1 < LATENCY_HISTOGRAM_BUCKET_COUNT; value >>= 1) {
+		++latency_bucket;
+	}
+	for (Window& window : windows_) {
+		const uint64_t bucket_number = GetBucketNumber(window, time);
+		const uint64_t tag = GetTag(bucket_number);
+		Bucket& bucket = window.buckets[bucket_number % WINDOW_BUCKET_COUNT];
+		Increment(bucket.counters[REQUEST_COUNTER], tag);
+		if (result_count == 0) {
+			Increment(bucket.counters[NO_RESULT_COUNTER], tag);
+		}
+		Increment(bucket.counters[FIRST_LATENCY_COUNTER + latency_bucket], tag);
+	}
+}
+
+RequestWindowStats RequestStatistics::GetStats(size_t window_index, Clock::time_point now) const {
+	const Window& window = windows_.at(window_index);
+	RequestWindowStats stats;
+	stats.window = window.length;
+	const uint64_t last_bucket_number = GetBucketNumber(window, now);
+	// The current bucket is partly filled, so the window reaches back WINDOW_BUCKET_COUNT - 1 full buckets
+	for (uint64_t age = 0; age < WINDOW_BUCKET_COUNT && age <= last_bucket_number; ++age) {
+		const uint64_t bucket_number = last_bucket_number - age;
+		const uint64_t tag = GetTag(bucket_number);
+		const Bucket& bucket = window.buckets[bucket_number % WINDOW_BUCKET_COUNT];
+		stats.request_count += Load(bucket.counters[REQUEST_COUNTER], tag);
+		stats.no_result_count += Load(bucket.counters[NO_RESULT_COUNTER], tag);
+		for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; ++i) {
+			stats.latency_histogram[i] += Load(bucket.counters[FIRST_LATENCY_COUNTER + i], tag);
+		}
+	}
+	stats.queries_per_second = static_cast<double>(stats.request_count) / window.length.count();
+	stats.no_result_rate = stats.request_count > 0
+		? static_cast<double>(stats.no_result_count) / stats.request_count : 0.0;
+	return stats;
+}
+
+size_t RequestStatistics::GetWindowCount() const {
+	return windows_.size();
+}
+
+uint64_t RequestStatistics::GetBucketNumber(const Window& window, Clock::time_point time) const {
+	return time > origin_ ? static_cast<uint64_t>((time - origin_) / window.bucket_length) : 0;
+}
+
+uint64_t RequestStatistics::GetTag(uint64_t bucket_number) {
+	return bucket_number & ((uint64_t{ 1 } << TAG_BITS) - 1);
+}
+
+void RequestStatistics::Increment(std::atomic<uint64_t>& counter, uint64_t tag) {
+	const uint64_t tag_mask = (uint64_t{ 1 } << TAG_BITS) - 1;
+	uint64_t value = counter.load(std::memory_order_relaxed);
+	while (true) {
+		const uint64_t counter_tag = value >> COUNT_BITS;
+		uint64_t next;
+		if (counter_tag == tag) {
+			next = value + 1;
+		}
+		else if (((counter_tag - tag) & tag_mask) < (tag_mask >> 1)) {
+			// The bucket is already reused for a later time, the update is out of every window
+			return;
+		}
+		else {
+			next = (tag << COUNT_BITS) | 1;
+		}
+		if (counter.compare_exchange_weak(value, next, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+}
+
+uint64_t RequestStatistics::Load(const std::atomic<uint64_t>& counter, uint64_t tag) {
+	const uint64_t value = counter.load(std::memory_order_relaxed);
+	return (value >> COUNT_BITS) == tag ? value & ((uint64_t{ 1 } << COUNT_BITS) - 1) : 0;
+}
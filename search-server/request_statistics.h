@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bucket 0 counts latencies under 1 us, bucket k latencies in [2^(k-1), 2^k) us, the last one everything longer
+const size_t LATENCY_HISTOGRAM_BUCKET_COUNT = 24;
+// Every window is a ring of this many time buckets, it slides by one bucket at a time
+const size_t WINDOW_BUCKET_COUNT = 60;
+
+struct RequestWindowStats {
+	std::chrono::seconds window;
+	uint64_t request_count = 0;
+	uint64_t no_result_count = 0;
+	double queries_per_second = 0.0;
+	double no_result_rate = 0.0;
+	std::array<uint64_t, LATENCY_HISTOGRAM_BUCKET_COUNT> latency_histogram{};
+
+	// Upper bound of the histogram bucket holding the given quantile of latencies, zero without requests
+	std::chrono::microseconds GetLatencyQuantile(double quantile) const;
+};
+
+// Request counters over sliding wall-clock windows, safe to update from many threads at once.
+// An update is a few compare-and-swap loops on the current bucket of every window, no locks are taken.
+// Every counter carries the number of the time bucket it counts for: the first update in a new bucket
+// starts its counter over, and updates too late for a reused bucket are dropped.
+class RequestStatistics {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Windows must be at least WINDOW_BUCKET_COUNT clock ticks long
+	explicit RequestStatistics(const std::vector<std::chrono::seconds>& windows = {
+		std::chrono::minutes(1), std::chrono::hours(1), std::chrono::hours(24) });
+
+	void Record(Clock::time_point time, Clock::duration latency, size_t result_count);
+
+	// Statistics of windows[window_index] ending at now
+	RequestWindowStats GetStats(size_t window_index, Clock::time_point now = Clock::now()) const;
+
+	size_t GetWindowCount() const;
+
+private:
+	static const size_t REQUEST_COUNTER = 0;
+	static const size_t NO_RESULT_COUNTER = 1;
+	static const size_t FIRST_LATENCY_COUNTER = 2;
+	static const size_t COUNTER_COUNT = FIRST_LATENCY_COUNTER + LATENCY_HISTOGRAM_BUCKET_COUNT;
+
+	// A counter keeps its bucket number in the high TAG_BITS and the count in the low COUNT_BITS
+	static const int TAG_BITS = 24;
+	static const int COUNT_BITS = 64 - TAG_BITS;
+
+	struct Bucket {
+		std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+	};
+
+	struct Window {
+		std::chrono::seconds length;
+		Clock::duration bucket_length;
+		std::unique_ptr<Bucket[]> buckets;
+	};
+
+	const Clock::time_point origin_;
+	std::vector<Window> windows_;
+
+	uint64_t GetBucketNumber(const Window& window, Clock::time_point time) const;
+
+	static uint64_t GetTag(uint64_t bucket_number);
+
+	static void Increment(std::atomic<uint64_t>& counter, uint64_t tag);
+
+	static uint64_t Load(const std::atomic<uint64_t>& counter, uint64_t tag);
+};
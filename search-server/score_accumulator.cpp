@@ -0,0 +1,108 @@
+#include "score_accumulator.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SEARCH_SERVER_HAS_AVX2_KERNEL 1
+#endif
+
+void AddScoresScalar(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal) {
+	for (size_t i = 0; i < count; ++i) {
+		scores[ordinals[i] - first_ordinal] += term_freqs[i] * inverse_document_freq;
+	}
+}
+
+#ifdef SEARCH_SERVER_HAS_AVX2_KERNEL
+
+__attribute__((target("avx2")))
+void AddScoresAvx2(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal) {
+	const __m256d inverse_document_freqs = _mm256_set1_pd(inverse_document_freq);
+	const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	const __m128i first_ordinals = _mm_set1_epi32(first_ordinal);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i indexes = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ordinals + i)),
+			first_ordinals);
+		const __m256d current = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), scores, indexes, all_lanes,
+			sizeof(double));
+		const __m256d added = _mm256_mul_pd(_mm256_loadu_pd(term_freqs + i), inverse_document_freqs);
+		alignas(32) double updated[4];
+		_mm256_store_pd(updated, _mm256_add_pd(current, added));
+		// AVX2 has no scatter
+		scores[ordinals[i] - first_ordinal] = updated[0];
+		scores[ordinals[i + 1] - first_ordinal] = updated[1];
+		scores[ordinals[i + 2] - first_ordinal] = updated[2];
+		scores[ordinals[i + 3] - first_ordinal] = updated[3];
+	}
+	AddScoresScalar(ordinals + i, term_freqs + i, count - i, inverse_document_freq, scores, first_ordinal);
+}
+
+bool HasAvx2ScoreKernel() {
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	return has_avx2;
+}
+
+#else
+
+void AddScoresAvx2(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal) {
+	AddScoresScalar(ordinals, term_freqs, count, inverse_document_freq, scores, first_ordinal);
+}
+
+bool HasAvx2ScoreKernel() {
+	return false;
+}
+
+#endif
+
+void AddScores(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal) {
+	if (HasAvx2ScoreKernel()) {
+		AddScoresAvx2(ordinals, term_freqs, count, inverse_document_freq, scores, first_ordinal);
+	}
+	else {
+		AddScoresScalar(ordinals, term_freqs, count, inverse_document_freq, scores, first_ordinal);
+	}
+}
+
+DenseScoreAccumulator::DenseScoreAccumulator(size_t ordinal_count, std::pmr::memory_resource* resource)
+	: DenseScoreAccumulator(0, ordinal_count, resource) {
+}
+
+DenseScoreAccumulator::DenseScoreAccumulator(int first_ordinal, size_t ordinal_count,
+	std::pmr::memory_resource* resource)
+	: first_ordinal_(first_ordinal)
+	, scores_(ordinal_count, 0.0, resource)
+	, matched_((ordinal_count + WORD_BITS - 1) / WORD_BITS, 0, resource) {
+}
+
+void DenseScoreAccumulator::Add(const int* ordinals, const double* term_freqs, size_t count,
+	double inverse_document_freq) {
+	AddScores(ordinals, term_freqs, count, inverse_document_freq, scores_.data(), first_ordinal_);
+	for (size_t i = 0; i < count; ++i) {
+		const size_t offset = static_cast<size_t>(ordinals[i] - first_ordinal_);
+		matched_[offset / WORD_BITS] |= uint64_t{ 1 } << (offset % WORD_BITS);
+	}
+}
+
+void DenseScoreAccumulator::Intersect(const std::vector<uint64_t>& words) {
+	const size_t first_word = static_cast<size_t>(first_ordinal_) / WORD_BITS;
+	const size_t common_size = std::min(words.size() - std::min(words.size(), first_word), matched_.size());
+	for (size_t i = 0; i < common_size; ++i) {
+		matched_[i] &= words[first_word + i];
+	}
+	std::fill(matched_.begin() + common_size, matched_.end(), 0);
+}
+
+void DenseScoreAccumulator::Exclude(const int* ordinals, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		// Ordinals before the range wrap around to large offsets
+		const size_t offset = static_cast<size_t>(ordinals[i] - first_ordinal_);
+		if (offset / WORD_BITS < matched_.size()) {
+			matched_[offset / WORD_BITS] &= ~(uint64_t{ 1 } << (offset % WORD_BITS));
+		}
+	}
+}
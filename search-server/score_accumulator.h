@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// Adds term_freqs[i] * inverse_document_freq to scores[ordinals[i] - first_ordinal]. Ordinals must be distinct,
+// as in one posting list. Every kernel multiplies and adds separately, so they produce identical sums.
+void AddScores(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal);
+
+void AddScoresScalar(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal);
+
+// Gathers four scores at a time; call only if HasAvx2ScoreKernel()
+void AddScoresAvx2(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq,
+	double* scores, int first_ordinal);
+
+bool HasAvx2ScoreKernel();
+
+inline int CountTrailingZeros(uint64_t word) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int count = 0;
+	for (; (word & 1) == 0; word >>= 1) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+// Score-at-a-time accumulator over a range of document ordinals with a bitmap of matched documents.
+// Pays off when the query postings are not much fewer than the ordinals.
+class DenseScoreAccumulator {
+public:
+	DenseScoreAccumulator(size_t ordinal_count, std::pmr::memory_resource* resource);
+
+	// Covers the ordinals [first_ordinal, first_ordinal + ordinal_count), first_ordinal must be a multiple of 64
+	DenseScoreAccumulator(int first_ordinal, size_t ordinal_count, std::pmr::memory_resource* resource);
+
+	// Ordinals must lie in the range
+	void Add(const int* ordinals, const double* term_freqs, size_t count, double inverse_document_freq);
+
+	// Keeps matched only the documents present in the bitset words, which cover all ordinals from 0
+	void Intersect(const std::vector<uint64_t>& words);
+
+	// Unmatches the documents with the given ordinals
+	void Exclude(const int* ordinals, size_t count);
+
+	// Appends (ordinal, relevance) of the matched documents accepted by filter in ordinal order
+	template <typename Filter, typename Documents>
+	void Collect(Filter filter, Documents& documents) const {
+		for (size_t word_index = 0; word_index < matched_.size(); ++word_index) {
+			for (uint64_t word = matched_[word_index]; word != 0; word &= word - 1) {
+				const size_t offset = word_index * WORD_BITS + CountTrailingZeros(word);
+				const int ordinal = first_ordinal_ + static_cast<int>(offset);
+				if (filter(ordinal)) {
+					documents.emplace_back(ordinal, scores_[offset]);
+				}
+			}
+		}
+	}
+
+private:
+	static const size_t WORD_BITS = 64;
+
+	int first_ordinal_;
+	std::pmr::vector<double> scores_;
+	std::pmr::vector<uint64_t> matched_;
+};
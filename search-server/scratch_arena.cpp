@@ -0,0 +1,81 @@
+#include "scratch_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace {
+
+const size_t INITIAL_SCRATCH_SIZE = 16 * 1024;
+const size_t MAX_SCRATCH_SIZE = 16 * 1024 * 1024;
+
+// Takes memory beyond the buffer from the heap and counts it to size the buffer for the next queries
+class OverflowResource final : public std::pmr::memory_resource {
+public:
+	size_t TakeAllocatedBytes() {
+		const size_t allocated_bytes = allocated_bytes_;
+		allocated_bytes_ = 0;
+		return allocated_bytes;
+	}
+
+private:
+	size_t allocated_bytes_ = 0;
+
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		allocated_bytes_ += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+struct ScratchArena {
+	std::unique_ptr<std::byte[]> buffer;
+	size_t buffer_size = 0;
+	OverflowResource overflow;
+	std::optional<std::pmr::monotonic_buffer_resource> resource;
+	int depth = 0;
+
+	ScratchArena() {
+		Allocate(INITIAL_SCRATCH_SIZE);
+	}
+
+	void Allocate(size_t size) {
+		resource.reset();
+		buffer = std::make_unique<std::byte[]>(size);
+		buffer_size = size;
+		resource.emplace(buffer.get(), buffer_size, &overflow);
+	}
+};
+
+ScratchArena& GetThreadArena() {
+	thread_local ScratchArena arena;
+	return arena;
+}
+
+}  // namespace
+
+ScratchScope::ScratchScope() {
+	ScratchArena& arena = GetThreadArena();
+	++arena.depth;
+	resource_ = &*arena.resource;
+}
+
+ScratchScope::~ScratchScope() {
+	ScratchArena& arena = GetThreadArena();
+	if (--arena.depth > 0) {
+		return;
+	}
+	arena.resource->release();
+	const size_t overflow_bytes = arena.overflow.TakeAllocatedBytes();
+	if (overflow_bytes > 0 && arena.buffer_size < MAX_SCRATCH_SIZE) {
+		arena.Allocate(std::min(MAX_SCRATCH_SIZE, arena.buffer_size + overflow_bytes));
+	}
+}
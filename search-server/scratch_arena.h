@@ -0,0 +1,23 @@
+#pragma once
+#include <memory_resource>
+
+// Temporary memory of one query on the current thread. Allocation bumps a pointer, deallocation does
+// nothing, and all of it is reused once the outermost scope of the thread ends. A query that outgrew
+// the thread's buffer enlarges it for the next ones, so repeated queries stop calling malloc.
+// Scopes may nest, as when a waiting thread of a parallel algorithm picks up another query's task.
+class ScratchScope {
+public:
+	ScratchScope();
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	~ScratchScope();
+
+	std::pmr::memory_resource* GetResource() const {
+		return resource_;
+	}
+
+private:
+	std::pmr::memory_resource* resource_;
+};
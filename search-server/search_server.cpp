@@ -2,71 +2,195 @@
 
 #include <cmath>
 #include <algorithm>
+#include <functional>
 #include <iostream>
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+#include "snapshot_io.h"
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
 	const std::vector<int>& ratings) {
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	if ((document_id < 0) || (document_ids_.count(document_id) > 0)) {
 		throw std::invalid_argument("Invalid document_id");
 	}
 	const auto words = SplitIntoWordsNoStop(document);
-	const double inv_word_count = 1.0 / words.size();
-	for (const std::string& word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		document_to_word_freqs_[document_id][word] = word_to_document_freqs_[word][document_id];
+	const uint32_t length = static_cast<uint32_t>(words.size());
+	std::vector<TermId> term_ids;
+	term_ids.reserve(words.size());
+	for (const std::string_view word : words) {
+		term_ids.push_back(terms_.Intern(word));
+	}
+	ResizePostings();
+	std::sort(term_ids.begin(), term_ids.end());
+
+	const int document_ordinal = AddDocumentOrdinal(document_id, status, ComputeAverageRating(ratings), length);
+	DocumentTerms& document_terms = document_to_word_freqs_[document_ordinal];
+	for (const TermId term_id : term_ids) {
+		if (document_terms.term_ids.empty() || document_terms.term_ids.back() != term_id) {
+			document_terms.term_ids.push_back(term_id);
+			document_terms.term_counts.push_back(0);
+		}
+		++document_terms.term_counts.back();
 	}
-	documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-	document_ids_[document_id];
+	for (size_t i = 0; i < document_terms.term_ids.size(); ++i) {
+		AddPosting(document_terms.term_ids[i], document_ordinal, ComputeTermFreq(document_terms.term_counts[i], length));
+		UpdateDocumentFreq(document_terms.term_ids[i]);
+	}
+	log_document_count_ = log(document_ids_.size());
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
-	return FindTopDocuments(
-		raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-			return document_status == status;
-		});
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+	size_t result_count) const {
+	return FindTopDocuments(raw_query, DocumentStatusPredicate{ status }, result_count);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
-	LOG_DURATION_STREAM("FindTopDocuments", cout);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
 	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query,
+std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query,
 	int document_id) const {
-	LOG_DURATION_STREAM("MatchDocuments", cout);
-	const auto query = ParseQuery(raw_query);
+	const auto [words, status] = MatchDocument(std::execution::seq, raw_query, document_id);
+	return { std::vector<std::string>(words.begin(), words.end()), status };
+}
 
-	std::vector<std::string> matched_words;
-	for (const std::string& word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
+	const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
+	TRACE_SCOPE("match_document");
+	ScratchScope scratch;
+	const auto query = ParseQuery(raw_query, scratch.GetResource());
+	const int document_ordinal = document_ids_.at(document_id);
+	return { MatchQueryTerms(FindQueryTerms(query), document_ordinal), document_statuses_[document_ordinal] };
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
+	const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
+	TRACE_SCOPE("match_document");
+	ScratchScope scratch;
+	const auto query = ParseQuery(raw_query, scratch.GetResource());
+	const int document_ordinal = document_ids_.at(document_id);
+	const DocumentStatus status = document_statuses_[document_ordinal];
+	const QueryTerms terms = FindQueryTerms(query);
+	if (std::any_of(std::execution::par, terms.minus_terms.begin(), terms.minus_terms.end(), [&](TermId term_id) {
+		return HasPosting(term_id, document_ordinal);
+		})) {
+		return { std::vector<std::string_view>(), status };
+	}
+	// Plus-words are unique and non-empty, so an empty view marks a word the document lacks
+	std::vector<std::string_view> matched_words(terms.plus_terms.size());
+	std::transform(std::execution::par, terms.plus_terms.begin(), terms.plus_terms.end(), matched_words.begin(),
+		[&](TermId term_id) {
+			return HasPosting(term_id, document_ordinal) ? terms_.GetWord(term_id) : std::string_view();
+		});
+	matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view()),
+		matched_words.end());
+	return { matched_words, status };
+}
+
+std::vector<DocumentMatch> SearchServer::MatchAllDocuments(std::string_view raw_query) const {
+	return MatchAllDocuments(std::execution::seq, raw_query);
+}
+
+std::vector<DocumentMatch> SearchServer::MatchAllDocuments(const std::execution::sequenced_policy&,
+	std::string_view raw_query) const {
+	ScratchScope scratch;
+	const QueryTerms terms = FindQueryTerms(ParseQuery(raw_query, scratch.GetResource()));
+	std::vector<DocumentMatch> result;
+	result.reserve(document_ids_.size());
+	for (const auto& [document_id, document_ordinal] : document_ids_) {
+		result.push_back({ document_id, MatchQueryTerms(terms, document_ordinal), document_statuses_[document_ordinal] });
+	}
+	return result;
+}
+
+std::vector<DocumentMatch> SearchServer::MatchAllDocuments(const std::execution::parallel_policy&,
+	std::string_view raw_query) const {
+	ScratchScope scratch;
+	const QueryTerms terms = FindQueryTerms(ParseQuery(raw_query, scratch.GetResource()));
+	const std::vector<std::pair<int, int>> documents(document_ids_.begin(), document_ids_.end());
+	std::vector<DocumentMatch> result(documents.size());
+	std::transform(std::execution::par, documents.begin(), documents.end(), result.begin(),
+		[&](const std::pair<int, int>& document) {
+			const auto [document_id, document_ordinal] = document;
+			return DocumentMatch{ document_id, MatchQueryTerms(terms, document_ordinal), document_statuses_[document_ordinal] };
+		});
+	return result;
+}
+
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentStatus status,
+	size_t page, size_t page_size) const {
+	return FindTopDocumentsPage(raw_query, DocumentStatusPredicate{ status }, page, page_size);
+}
+
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const {
+	return FindTopDocumentsPage(raw_query, DocumentStatus::ACTUAL, page, page_size);
+}
+
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentStatus status,
+	const SearchCursor& cursor, size_t page_size) const {
+	return FindTopDocumentsPage(raw_query, DocumentStatusPredicate{ status }, cursor, page_size);
+}
+
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, const SearchCursor& cursor,
+	size_t page_size) const {
+	return FindTopDocumentsPage(raw_query, DocumentStatus::ACTUAL, cursor, page_size);
+}
+
+DocumentPage SearchServer::MakeDocumentPage(const std::vector<Document>& documents, size_t first, size_t page_size) {
+	const size_t last = first + std::min(documents.size() - first, page_size);
+	DocumentPage page;
+	page.documents.assign(documents.begin() + first, documents.begin() + last);
+	if (last < documents.size()) {
+		page.next = SearchCursor{ documents[last - 1] };
+	}
+	return page;
+}
+
+void SearchServer::CheckPageSize(size_t page_size) {
+	if (page_size == 0) {
+		throw std::invalid_argument("Page size must be positive");
+	}
+}
+
+SearchServer::QueryTerms SearchServer::FindQueryTerms(const Query& query) const {
+	QueryTerms terms;
+	for (const std::string_view word : query.plus_words) {
+		if (const auto term_id = terms_.Find(word)) {
+			terms.plus_terms.push_back(*term_id);
 		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			matched_words.push_back(word);
+	}
+	for (const std::string_view word : query.minus_words) {
+		if (const auto term_id = terms_.Find(word)) {
+			terms.minus_terms.push_back(*term_id);
 		}
 	}
-	for (const std::string& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
+	return terms;
+}
+
+std::vector<std::string_view> SearchServer::MatchQueryTerms(const QueryTerms& terms, int document_ordinal) const {
+	std::vector<std::string_view> matched_words;
+	for (const TermId term_id : terms.minus_terms) {
+		if (HasPosting(term_id, document_ordinal)) {
+			return matched_words;
 		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			matched_words.clear();
-			break;
+	}
+	for (const TermId term_id : terms.plus_terms) {
+		if (HasPosting(term_id, document_ordinal)) {
+			matched_words.push_back(terms_.GetWord(term_id));
 		}
 	}
-	return { matched_words, documents_.at(document_id).status };
+	return matched_words;
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
+bool SearchServer::IsStopWord(std::string_view word) const {
 	return stop_words_.count(word) > 0;
 }
 
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-	std::vector<std::string> words;
-	for (const std::string& word : SplitIntoWords(text)) {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+	std::vector<std::string_view> words;
+	for (const std::string_view word : SplitIntoWords(text)) {
 		if (!IsValidWord(word)) {
-			throw std::invalid_argument("Word " + word + " is invalid");
+			throw std::invalid_argument("Word " + std::string(word) + " is invalid");
 		}
 		if (!IsStopWord(word)) {
 			words.push_back(word);
@@ -75,46 +199,167 @@ std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& t
 	return words;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
 	if (text.empty()) {
 		throw std::invalid_argument("Query word is empty");
 	}
-	std::string word = text;
+	std::string_view word = text;
 	bool is_min = false;
 	if (word[0] == '-') {
 		is_min = true;
-		word = word.substr(1);
+		word.remove_prefix(1);
 	}
 	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-		throw std::invalid_argument("Query word " + text + " is invalid");
+		throw std::invalid_argument("Query word " + std::string(text) + " is invalid");
 	}
 	return { word, is_min, IsStopWord(word) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
-	Query result;
-	for (const std::string& word : SplitIntoWords(text)) {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const {
+	TRACE_SCOPE("query.parse");
+	Query result(resource);
+	ForEachWord(text, [&](std::string_view word) {
 		const auto query_word = ParseQueryWord(word);
 		if (!query_word.is_stop) {
 			if (query_word.is_minus) {
-				result.minus_words.insert(query_word.data);
+				result.minus_words.push_back(query_word.data);
 			}
 			else {
-				result.plus_words.insert(query_word.data);
+				result.plus_words.push_back(query_word.data);
 			}
 		}
+		});
+	for (auto* words : { &result.plus_words, &result.minus_words }) {
+		std::sort(words->begin(), words->end());
+		words->erase(std::unique(words->begin(), words->end()), words->end());
 	}
 	return result;
 }
 
 // Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-	double res = GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size();
-	double res_ret = log(res);
-	return res_ret;
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+	if (inverse_document_freqs_frozen_ && term_id < frozen_inverse_document_freqs_.size()) {
+		return frozen_inverse_document_freqs_[term_id];
+	}
+	return log_document_count_ - log_document_freqs_[term_id];
+}
+
+void SearchServer::UpdateDocumentFreq(TermId term_id) {
+	const size_t document_freq = GetDocumentFreq(term_id);
+	log_document_freqs_[term_id] = document_freq > 0 ? log(document_freq) : 0.0;
+}
+
+void SearchServer::ResizePostings() {
+	if (index_mode_ == IndexMode::PLAIN) {
+		word_to_document_freqs_.resize(terms_.size());
+	}
+	else {
+		compressed_postings_.resize(terms_.size());
+	}
+	removed_postings_.resize(terms_.size());
+	log_document_freqs_.resize(terms_.size());
+}
+
+size_t SearchServer::GetDocumentFreq(TermId term_id) const {
+	const size_t posting_count = index_mode_ == IndexMode::PLAIN ? word_to_document_freqs_[term_id].size()
+		: compressed_postings_[term_id].size();
+	return posting_count - removed_postings_[term_id];
 }
 
-void AddDocument(SearchServer& search_server, int document_id, const std::string& document,
+bool SearchServer::HasPosting(TermId term_id, int document_ordinal) const {
+	const std::vector<TermId>& term_ids = document_to_word_freqs_[document_ordinal].term_ids;
+	return std::binary_search(term_ids.begin(), term_ids.end(), term_id);
+}
+
+void SearchServer::AddPosting(TermId term_id, int document_ordinal, double term_freq) {
+	if (index_mode_ == IndexMode::PLAIN) {
+		word_to_document_freqs_[term_id].Insert(document_ordinal, term_freq);
+	}
+	else {
+		compressed_postings_[term_id].Append(document_ordinal,
+			static_cast<uint32_t>(std::lround(term_freq * document_lengths_[document_ordinal])));
+	}
+}
+
+PostingList SearchServer::DecodePostings(TermId term_id) const {
+	PostingList postings;
+	ForEachPostingsBlock(term_id, [&](const int* document_ordinals, const double* term_freqs, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			if (document_ordinal_ids_[document_ordinals[i]] >= 0) {
+				postings.Insert(document_ordinals[i], term_freqs[i]);
+			}
+		}
+		});
+	return postings;
+}
+
+bool SearchServer::HasMinusWord(const Query& query, int document_ordinal) const {
+	return std::any_of(query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view word) {
+		const auto term_id = terms_.Find(word);
+		return term_id && HasPosting(*term_id, document_ordinal);
+		});
+}
+
+void SearchServer::EraseMinusWordDocuments(const Query& query, MatchedOrdinals& documents) const {
+	if (index_mode_ == IndexMode::COMPRESSED) {
+		// Compressed lists are probed block by block through their skip pointers
+		documents.erase(std::remove_if(documents.begin(), documents.end(), [&](const std::pair<int, double>& document) {
+			return HasMinusWord(query, document.first);
+			}), documents.end());
+		return;
+	}
+	for (const std::string_view word : query.minus_words) {
+		if (documents.empty()) {
+			break;
+		}
+		const auto term_id = terms_.Find(word);
+		if (!term_id) {
+			continue;
+		}
+		EraseDocumentsIn(documents, word_to_document_freqs_[*term_id].GetDocumentIds(),
+			[](const std::pair<int, double>& document) {
+				return document.first;
+			});
+	}
+}
+
+std::vector<Document> SearchServer::MakeDocuments(const MatchedOrdinals& documents) const {
+	std::vector<Document> result;
+	result.reserve(documents.size());
+	for (const auto& [document_ordinal, relevance] : documents) {
+		result.push_back({ document_ordinal_ids_[document_ordinal], relevance, document_ratings_[document_ordinal] });
+	}
+	return result;
+}
+
+int SearchServer::AddDocumentOrdinal(int document_id, DocumentStatus status, int rating, uint32_t length) {
+	const int document_ordinal = static_cast<int>(document_ordinal_ids_.size());
+	document_ordinal_ids_.push_back(document_id);
+	document_ratings_.push_back(rating);
+	document_statuses_.push_back(status);
+	document_lengths_.push_back(length);
+	document_to_word_freqs_.emplace_back();
+	if (static_cast<size_t>(status) < DOCUMENT_STATUS_COUNT) {
+		status_documents_[static_cast<size_t>(status)].Set(document_ordinal);
+	}
+	document_ids_.emplace(document_id, document_ordinal);
+	++generation_;
+	return document_ordinal;
+}
+
+void SearchServer::RemoveDocumentOrdinal(int document_id, int document_ordinal) {
+	document_to_word_freqs_[document_ordinal] = DocumentTerms();
+	document_ordinal_ids_[document_ordinal] = -1;
+	const size_t status = static_cast<size_t>(document_statuses_[document_ordinal]);
+	if (status < DOCUMENT_STATUS_COUNT) {
+		status_documents_[status].Reset(document_ordinal);
+	}
+	document_ids_.erase(document_id);
+	log_document_count_ = document_ids_.empty() ? 0.0 : log(document_ids_.size());
+	++generation_;
+}
+
+void AddDocument(SearchServer& search_server, int document_id, std::string_view document,
 	DocumentStatus status, const std::vector<int>& ratings) {
 	try {
 		search_server.AddDocument(document_id, document, status, ratings);
@@ -124,7 +369,7 @@ void AddDocument(SearchServer& search_server, int document_id, const std::string
 	}
 }
 
-void FindTopDocuments(const SearchServer& search_server, const std::string& raw_query) {
+void FindTopDocuments(const SearchServer& search_server, std::string_view raw_query) {
 	std::cout << "Results for request: " << raw_query << std::endl;
 	try {
 		for (const Document& document : search_server.FindTopDocuments(raw_query)) {
@@ -136,12 +381,11 @@ void FindTopDocuments(const SearchServer& search_server, const std::string& raw_
 	}
 }
 
-void MatchDocuments(const SearchServer& search_server, const std::string& query) {
+void MatchDocuments(const SearchServer& search_server, std::string_view query) {
 	try {
 		std::cout << "Matching for request: " << query << std::endl;
-		for (auto document_id = search_server.begin(); document_id != search_server.end(); document_id++) {
-			const auto [words, status] = search_server.MatchDocument(query, document_id->first);
-			PrintMatchDocumentResult(document_id->first, words, status);
+		for (const DocumentMatch& match : search_server.MatchAllDocuments(query)) {
+			PrintMatchDocumentResult(match.document_id, match.words, match.status);
 		}
 	}
 	catch (const std::exception& e) {
@@ -149,35 +393,580 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
 	}
 }
 
+std::string SearchServer::NormalizeQuery(std::string_view raw_query) const {
+	ScratchScope scratch;
+	const auto query = ParseQuery(raw_query, scratch.GetResource());
+	std::string result;
+	for (const std::string_view word : query.plus_words) {
+		result.append(word).push_back(' ');
+	}
+	for (const std::string_view word : query.minus_words) {
+		result.append("-").append(word).push_back(' ');
+	}
+	if (!result.empty()) {
+		result.pop_back();
+	}
+	return result;
+}
+
+void SearchServer::CollectQueryStatistics(std::string_view raw_query, CorpusStatistics& statistics) const {
+	ScratchScope scratch;
+	const auto query = ParseQuery(raw_query, scratch.GetResource());
+	statistics.document_count += GetDocumentCount();
+	for (const std::string_view word : query.plus_words) {
+		const auto term_id = terms_.Find(word);
+		const int document_freq = term_id ? static_cast<int>(GetDocumentFreq(*term_id)) : 0;
+		const auto document_freqs = statistics.document_freqs.find(word);
+		if (document_freqs != statistics.document_freqs.end()) {
+			document_freqs->second += document_freq;
+		}
+		else {
+			statistics.document_freqs.emplace(word, document_freq);
+		}
+	}
+}
+
+void SearchServer::AddDocumentsFrom(const SearchServer& other, const std::vector<int>& excluded_document_ids) {
+	const auto is_excluded = [&excluded_document_ids](int document_id) {
+		return std::binary_search(excluded_document_ids.begin(), excluded_document_ids.end(), document_id);
+	};
+	for (const auto& [document_id, other_ordinal] : other.document_ids_) {
+		if (!is_excluded(document_id) && document_ids_.count(document_id) > 0) {
+			throw std::invalid_argument("Invalid document_id");
+		}
+	}
+
+	// Postings are collected per term first, so that each posting list is merged once
+	std::vector<std::vector<std::pair<int, double>>> new_postings;
+	for (const auto& [document_id, other_ordinal] : other.document_ids_) {
+		if (is_excluded(document_id)) {
+			continue;
+		}
+		const DocumentTerms& other_terms = other.document_to_word_freqs_[other_ordinal];
+		std::vector<std::pair<TermId, uint32_t>> terms;
+		terms.reserve(other_terms.term_ids.size());
+		for (size_t i = 0; i < other_terms.term_ids.size(); ++i) {
+			terms.emplace_back(terms_.Intern(other.terms_.GetWord(other_terms.term_ids[i])), other_terms.term_counts[i]);
+		}
+		std::sort(terms.begin(), terms.end());
+		new_postings.resize(terms_.size());
+
+		const uint32_t length = other.document_lengths_[other_ordinal];
+		const int document_ordinal = AddDocumentOrdinal(document_id, other.document_statuses_[other_ordinal],
+			other.document_ratings_[other_ordinal], length);
+		DocumentTerms& document_terms = document_to_word_freqs_[document_ordinal];
+		document_terms.term_ids.reserve(terms.size());
+		document_terms.term_counts.reserve(terms.size());
+		for (const auto& [term_id, term_count] : terms) {
+			document_terms.term_ids.push_back(term_id);
+			document_terms.term_counts.push_back(term_count);
+			new_postings[term_id].emplace_back(document_ordinal, ComputeTermFreq(term_count, length));
+		}
+	}
+
+	MergePostings(new_postings);
+	log_document_count_ = document_ids_.empty() ? 0.0 : log(document_ids_.size());
+}
+
+AddDocumentsResult SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+	AddDocumentsResult result;
+	std::vector<std::string> errors(documents.size());
+	for (size_t i = 0; i < documents.size(); ++i) {
+		if (documents[i].id < 0 || document_ids_.count(documents[i].id) > 0) {
+			errors[i] = "Invalid document_id";
+		}
+	}
+
+	// Words of every document sorted, so that equal words are adjacent
+	std::vector<std::vector<std::string_view>> document_words(documents.size());
+	std::vector<size_t> indexes(documents.size());
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+		if (!errors[i].empty()) {
+			return;
+		}
+		try {
+			document_words[i] = SplitIntoWordsNoStop(documents[i].text);
+		}
+		catch (const std::invalid_argument& e) {
+			errors[i] = e.what();
+			return;
+		}
+		std::sort(document_words[i].begin(), document_words[i].end());
+		});
+
+	// The dictionary is shared, so words are interned by one thread.
+	// Of several valid documents with one id the first is added, as a loop of AddDocument would do.
+	std::vector<DocumentTerms> document_terms(documents.size());
+	std::set<int> batch_ids;
+	for (size_t i = 0; i < documents.size(); ++i) {
+		if (errors[i].empty() && !batch_ids.insert(documents[i].id).second) {
+			errors[i] = "Invalid document_id";
+		}
+		if (!errors[i].empty()) {
+			continue;
+		}
+		const auto& words = document_words[i];
+		for (size_t j = 0; j < words.size(); ++j) {
+			if (j == 0 || words[j] != words[j - 1]) {
+				document_terms[i].term_ids.push_back(terms_.Intern(words[j]));
+				document_terms[i].term_counts.push_back(0);
+			}
+			++document_terms[i].term_counts.back();
+		}
+	}
+	std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+		DocumentTerms& terms = document_terms[i];
+		std::vector<std::pair<TermId, uint32_t>> sorted_terms;
+		sorted_terms.reserve(terms.term_ids.size());
+		for (size_t j = 0; j < terms.term_ids.size(); ++j) {
+			sorted_terms.emplace_back(terms.term_ids[j], terms.term_counts[j]);
+		}
+		std::sort(sorted_terms.begin(), sorted_terms.end());
+		for (size_t j = 0; j < sorted_terms.size(); ++j) {
+			terms.term_ids[j] = sorted_terms[j].first;
+			terms.term_counts[j] = sorted_terms[j].second;
+		}
+		});
+
+	// New ordinals grow in the order documents are visited, so every new posting list comes out sorted
+	std::vector<std::vector<std::pair<int, double>>> new_postings(terms_.size());
+	for (size_t i = 0; i < documents.size(); ++i) {
+		if (!errors[i].empty()) {
+			continue;
+		}
+		const DocumentInput& document = documents[i];
+		const uint32_t length = static_cast<uint32_t>(document_words[i].size());
+		const int document_ordinal = AddDocumentOrdinal(document.id, document.status,
+			ComputeAverageRating(document.ratings), length);
+		for (size_t j = 0; j < document_terms[i].term_ids.size(); ++j) {
+			new_postings[document_terms[i].term_ids[j]].emplace_back(document_ordinal,
+				ComputeTermFreq(document_terms[i].term_counts[j], length));
+		}
+		document_to_word_freqs_[document_ordinal] = std::move(document_terms[i]);
+		++result.added_count;
+	}
+	MergePostings(new_postings);
+	log_document_count_ = document_ids_.empty() ? 0.0 : log(document_ids_.size());
+
+	for (size_t i = 0; i < documents.size(); ++i) {
+		if (!errors[i].empty()) {
+			result.errors.push_back({ documents[i].id, std::move(errors[i]), i });
+		}
+	}
+	return result;
+}
+
+void SearchServer::MergePostings(std::vector<std::vector<std::pair<int, double>>>& new_postings) {
+	ResizePostings();
+	std::vector<TermId> term_ids;
+	for (TermId term_id = 0; term_id < new_postings.size(); ++term_id) {
+		if (!new_postings[term_id].empty()) {
+			term_ids.push_back(term_id);
+		}
+	}
+	// Every posting list is merged by one thread
+	std::for_each(std::execution::par, term_ids.begin(), term_ids.end(), [&](TermId term_id) {
+		for (const auto& [document_ordinal, term_freq] : new_postings[term_id]) {
+			AddPosting(term_id, document_ordinal, term_freq);
+		}
+		UpdateDocumentFreq(term_id);
+		});
+}
+
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return document_ids_.size();
+}
+
+bool SearchServer::HasDocument(int document_id) const {
+	return document_ids_.find(document_id) != document_ids_.end();
+}
+
+uint64_t SearchServer::GetGeneration() const {
+	return generation_;
+}
+
+void SearchServer::SetTopDocumentsMode(TopDocumentsMode mode) {
+	top_documents_mode_ = mode;
+}
+
+void SearchServer::SetIndexMode(IndexMode mode) {
+	if (mode == index_mode_) {
+		return;
+	}
+	if (mode == IndexMode::COMPRESSED) {
+		compressed_postings_.resize(terms_.size());
+		for (TermId term_id = 0; term_id < word_to_document_freqs_.size(); ++term_id) {
+			const PostingList& postings = word_to_document_freqs_[term_id];
+			for (size_t i = 0; i < postings.size(); ++i) {
+				const int document_ordinal = postings.GetDocumentIds()[i];
+				if (document_ordinal_ids_[document_ordinal] < 0) {
+					continue;
+				}
+				compressed_postings_[term_id].Append(document_ordinal,
+					static_cast<uint32_t>(std::lround(postings.GetTermFreqs()[i] * document_lengths_[document_ordinal])));
+			}
+		}
+		word_to_document_freqs_ = std::vector<PostingList>();
+	}
+	else {
+		std::vector<PostingList> postings(terms_.size());
+		for (TermId term_id = 0; term_id < compressed_postings_.size(); ++term_id) {
+			postings[term_id] = DecodePostings(term_id);
+		}
+		word_to_document_freqs_ = std::move(postings);
+		compressed_postings_ = std::vector<CompressedPostingList>();
+	}
+	// Postings of removed documents are not re-encoded
+	removed_postings_.assign(terms_.size(), 0);
+	index_mode_ = mode;
+}
+
+IndexMode SearchServer::GetIndexMode() const {
+	return index_mode_;
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const {
+	size_t memory_usage = 0;
+	for (const PostingList& postings : word_to_document_freqs_) {
+		memory_usage += postings.GetMemoryUsage();
+	}
+	for (const CompressedPostingList& postings : compressed_postings_) {
+		memory_usage += postings.GetMemoryUsage();
+	}
+	return memory_usage;
+}
+
+size_t SearchServer::GetMemoryUsage() const {
+	// A map node holds the pair, three links and the color
+	const size_t document_id_node_size = sizeof(std::pair<const int, int>) + 4 * sizeof(void*);
+	size_t memory_usage = sizeof(*this) + terms_.GetMemoryUsage() + GetPostingsMemoryUsage()
+		+ document_ids_.size() * document_id_node_size
+		+ document_ordinal_ids_.capacity() * sizeof(int) + document_ratings_.capacity() * sizeof(int)
+		+ document_statuses_.capacity() * sizeof(DocumentStatus) + document_lengths_.capacity() * sizeof(uint32_t)
+		+ document_to_word_freqs_.capacity() * sizeof(DocumentTerms)
+		+ (log_document_freqs_.capacity() + frozen_inverse_document_freqs_.capacity()) * sizeof(double)
+		+ removed_postings_.capacity() * sizeof(uint32_t);
+	for (const DocumentTerms& terms : document_to_word_freqs_) {
+		memory_usage += terms.term_ids.capacity() * sizeof(TermId) + terms.term_counts.capacity() * sizeof(uint32_t);
+	}
+	for (const DocumentBitset& documents : status_documents_) {
+		memory_usage += documents.GetWords().capacity() * sizeof(uint64_t);
+	}
+	return memory_usage;
+}
+
+void SearchServer::FreezeInverseDocumentFreqs() {
+	inverse_document_freqs_frozen_ = false;
+	frozen_inverse_document_freqs_.resize(log_document_freqs_.size());
+	for (TermId term_id = 0; term_id < log_document_freqs_.size(); ++term_id) {
+		frozen_inverse_document_freqs_[term_id] = ComputeWordInverseDocumentFreq(term_id);
+	}
+	inverse_document_freqs_frozen_ = true;
+	++generation_;
+}
+
+void SearchServer::UnfreezeInverseDocumentFreqs() {
+	inverse_document_freqs_frozen_ = false;
+	frozen_inverse_document_freqs_.clear();
+	++generation_;
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const {
-	static const std::map<std::string, double> dummy;
-	if (document_to_word_freqs_.count(document_id) != 0) {
-		return document_to_word_freqs_.at(document_id);
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+	static const DocumentTerms dummy;
+	const auto document_ordinal = document_ids_.find(document_id);
+	if (document_ordinal != document_ids_.end()) {
+		return WordFrequencies(terms_, document_to_word_freqs_[document_ordinal->second],
+			document_lengths_[document_ordinal->second]);
 	}
-	return dummy;
+	return WordFrequencies(terms_, dummy, 0);
+}
+
+const std::vector<TermId>& SearchServer::GetDocumentTermIds(int document_id) const {
+	static const std::vector<TermId> dummy;
+	const auto document_ordinal = document_ids_.find(document_id);
+	if (document_ordinal == document_ids_.end()) {
+		return dummy;
+	}
+	return document_to_word_freqs_[document_ordinal->second].term_ids;
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+	SnapshotWriter writer(path);
+	writer.Write<uint64_t>(stop_words_.size());
+	for (const std::string& stop_word : stop_words_) {
+		writer.WriteString(stop_word);
+	}
+	writer.Write<uint64_t>(terms_.size());
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id) {
+		writer.WriteString(terms_.GetWord(term_id));
+	}
+	// Postings of present documents are written decoded whatever the index mode is. Plain lists without
+	// removed postings are written as they are, the others are decoded into buffers shared by all terms.
+	std::vector<int> document_ordinals;
+	std::vector<double> term_freqs;
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id) {
+		if (index_mode_ == IndexMode::PLAIN && removed_postings_[term_id] == 0) {
+			const PostingList& postings = word_to_document_freqs_[term_id];
+			writer.WriteArray(postings.GetDocumentIds());
+			writer.WriteArray(postings.GetTermFreqs());
+			writer.Write(postings.GetMaxTermFreq());
+			continue;
+		}
+		document_ordinals.clear();
+		term_freqs.clear();
+		double max_term_freq = 0.0;
+		ForEachPostingsBlock(term_id, [&](const int* block_ordinals, const double* block_term_freqs, size_t size) {
+			for (size_t i = 0; i < size; ++i) {
+				if (document_ordinal_ids_[block_ordinals[i]] >= 0) {
+					document_ordinals.push_back(block_ordinals[i]);
+					term_freqs.push_back(block_term_freqs[i]);
+					max_term_freq = std::max(max_term_freq, block_term_freqs[i]);
+				}
+			}
+			});
+		writer.WriteArray(document_ordinals);
+		writer.WriteArray(term_freqs);
+		writer.Write(max_term_freq);
+	}
+	// Removed ordinals are written too, with id -1, so that postings load as they are
+	writer.Write<uint64_t>(document_ordinal_ids_.size());
+	for (size_t document_ordinal = 0; document_ordinal < document_ordinal_ids_.size(); ++document_ordinal) {
+		const DocumentTerms& document_terms = document_to_word_freqs_[document_ordinal];
+		writer.Write<int32_t>(document_ordinal_ids_[document_ordinal]);
+		writer.Write<int32_t>(document_ratings_[document_ordinal]);
+		writer.Write<int32_t>(static_cast<int32_t>(document_statuses_[document_ordinal]));
+		writer.Write<uint32_t>(document_lengths_[document_ordinal]);
+		writer.WriteArray(document_terms.term_ids);
+		writer.WriteArray(document_terms.term_counts);
+	}
+	writer.Write<int32_t>(static_cast<int32_t>(index_mode_));
+	writer.Finish();
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path) {
+	SnapshotReader reader(path);
+	std::vector<std::string_view> stop_words(reader.Read<uint64_t>());
+	for (std::string_view& stop_word : stop_words) {
+		stop_word = reader.ReadString();
+	}
+	SearchServer search_server(stop_words);
+
+	const uint64_t term_count = reader.Read<uint64_t>();
+	for (uint64_t i = 0; i < term_count; ++i) {
+		search_server.terms_.Intern(reader.ReadString());
+	}
+	if (search_server.terms_.size() != term_count) {
+		throw std::runtime_error("Snapshot is corrupted");
+	}
+	search_server.word_to_document_freqs_.reserve(term_count);
+	for (uint64_t i = 0; i < term_count; ++i) {
+		auto document_ids = reader.ReadArray<int>();
+		auto term_freqs = reader.ReadArray<double>();
+		const double max_term_freq = reader.Read<double>();
+		if (document_ids.size() != term_freqs.size()) {
+			throw std::runtime_error("Snapshot is corrupted");
+		}
+		search_server.word_to_document_freqs_.emplace_back(
+			std::move(document_ids), std::move(term_freqs), max_term_freq);
+	}
+
+	const uint64_t ordinal_count = reader.Read<uint64_t>();
+	for (uint64_t document_ordinal = 0; document_ordinal < ordinal_count; ++document_ordinal) {
+		const int document_id = reader.Read<int32_t>();
+		const int rating = reader.Read<int32_t>();
+		const auto status = static_cast<DocumentStatus>(reader.Read<int32_t>());
+		const uint32_t length = reader.Read<uint32_t>();
+		DocumentTerms document_terms{ reader.ReadArray<TermId>(), reader.ReadArray<uint32_t>() };
+		if (document_terms.term_ids.size() != document_terms.term_counts.size()
+			|| std::any_of(document_terms.term_ids.begin(), document_terms.term_ids.end(),
+				[term_count](TermId term_id) { return term_id >= term_count; })
+			|| std::adjacent_find(document_terms.term_ids.begin(), document_terms.term_ids.end(),
+				std::greater_equal<TermId>()) != document_terms.term_ids.end()
+			|| search_server.document_ids_.count(document_id) > 0) {
+			throw std::runtime_error("Snapshot is corrupted");
+		}
+		if (document_id < 0) {
+			search_server.document_ordinal_ids_.push_back(-1);
+			search_server.document_ratings_.push_back(rating);
+			search_server.document_statuses_.push_back(status);
+			search_server.document_lengths_.push_back(length);
+			search_server.document_to_word_freqs_.emplace_back();
+			continue;
+		}
+		// Frequencies are derived from the counts, which must add up to the document length
+		if (std::accumulate(document_terms.term_counts.begin(), document_terms.term_counts.end(), uint64_t{ 0 })
+			!= length) {
+			throw std::runtime_error("Snapshot is corrupted");
+		}
+		search_server.AddDocumentOrdinal(document_id, status, rating, length);
+		search_server.document_to_word_freqs_.back() = std::move(document_terms);
+	}
+	const auto index_mode = static_cast<IndexMode>(reader.Read<int32_t>());
+	// Every posting must refer to a present document, in strictly ascending order
+	const auto is_valid = [&search_server, ordinal_count](const PostingList& postings) {
+		int previous_ordinal = -1;
+		for (const int document_ordinal : postings.GetDocumentIds()) {
+			if (document_ordinal <= previous_ordinal || static_cast<uint64_t>(document_ordinal) >= ordinal_count
+				|| search_server.document_ordinal_ids_[document_ordinal] < 0) {
+				return false;
+			}
+			previous_ordinal = document_ordinal;
+		}
+		return true;
+	};
+	if (!reader.AtEnd() || (index_mode != IndexMode::PLAIN && index_mode != IndexMode::COMPRESSED)
+		|| !std::all_of(search_server.word_to_document_freqs_.begin(), search_server.word_to_document_freqs_.end(),
+			is_valid)) {
+		throw std::runtime_error("Snapshot is corrupted");
+	}
+
+	search_server.removed_postings_.resize(term_count);
+	search_server.log_document_freqs_.resize(term_count);
+	for (TermId term_id = 0; term_id < term_count; ++term_id) {
+		search_server.UpdateDocumentFreq(term_id);
+	}
+	search_server.log_document_count_ = search_server.document_ids_.empty() ? 0.0 : log(search_server.document_ids_.size());
+	search_server.SetIndexMode(index_mode);
+	return search_server;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-	documents_.erase(document_id);
-	document_ids_.erase(document_id);
+	RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
+	const auto document_ordinal = document_ids_.find(document_id);
+	if (document_ordinal == document_ids_.end()) {
+		return;
+	}
+	const int ordinal = document_ordinal->second;
+	// The ordinal is marked removed first, so that compaction drops its postings
+	const DocumentTerms document_terms = std::move(document_to_word_freqs_[ordinal]);
+	RemoveDocumentOrdinal(document_id, ordinal);
+	for (const TermId term_id : document_terms.term_ids) {
+		RemovePosting(term_id);
+	}
+	CompactOrdinals();
+}
 
-	for (const auto& [key, _] : GetWordFrequencies(document_id)) {
-		std::string key = key;
-		if (word_to_document_freqs_.count(key) > 0) {
-			auto temp = word_to_document_freqs_[key];
-			if (temp.count(document_id) > 0) {
-				temp.erase(document_id);
+void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
+	const auto document_ordinal = document_ids_.find(document_id);
+	if (document_ordinal == document_ids_.end()) {
+		return;
+	}
+	const int ordinal = document_ordinal->second;
+	const DocumentTerms document_terms = std::move(document_to_word_freqs_[ordinal]);
+	RemoveDocumentOrdinal(document_id, ordinal);
+	// Term ids of a document are unique, so every thread touches its own posting list
+	std::for_each(std::execution::par, document_terms.term_ids.begin(), document_terms.term_ids.end(),
+		[this](TermId term_id) {
+			RemovePosting(term_id);
+		});
+	CompactOrdinals();
+}
+
+void SearchServer::RemovePosting(TermId term_id) {
+	++removed_postings_[term_id];
+	const auto is_removed = [this](int document_ordinal) {
+		return document_ordinal_ids_[document_ordinal] < 0;
+	};
+	// release the storage of a word that no document contains anymore
+	if (index_mode_ == IndexMode::PLAIN) {
+		PostingList& postings = word_to_document_freqs_[term_id];
+		if (removed_postings_[term_id] >= postings.size() * REMOVED_POSTINGS_COMPACTION_SHARE) {
+			postings.RemoveIf(is_removed);
+			removed_postings_[term_id] = 0;
+			if (postings.empty()) {
+				postings = PostingList();
 			}
 		}
 	}
+	else {
+		CompressedPostingList& postings = compressed_postings_[term_id];
+		if (removed_postings_[term_id] >= postings.size() * REMOVED_POSTINGS_COMPACTION_SHARE) {
+			postings.RemoveIf(is_removed);
+			removed_postings_[term_id] = 0;
+		}
+	}
+	UpdateDocumentFreq(term_id);
+}
+
+void SearchServer::CompactOrdinals() {
+	const size_t ordinal_count = document_ordinal_ids_.size();
+	if (ordinal_count - document_ids_.size() < ordinal_count * REMOVED_ORDINALS_COMPACTION_SHARE) {
+		return;
+	}
+	// New ordinals keep the order of the old ones, so the posting lists stay sorted
+	std::vector<int> new_ordinals(ordinal_count, -1);
+	int new_ordinal = 0;
+	for (int ordinal = 0; ordinal < static_cast<int>(ordinal_count); ++ordinal) {
+		const int document_id = document_ordinal_ids_[ordinal];
+		if (document_id < 0) {
+			continue;
+		}
+		new_ordinals[ordinal] = new_ordinal;
+		document_ids_.find(document_id)->second = new_ordinal;
+		if (new_ordinal != ordinal) {
+			document_ordinal_ids_[new_ordinal] = document_id;
+			document_ratings_[new_ordinal] = document_ratings_[ordinal];
+			document_statuses_[new_ordinal] = document_statuses_[ordinal];
+			document_lengths_[new_ordinal] = document_lengths_[ordinal];
+			document_to_word_freqs_[new_ordinal] = std::move(document_to_word_freqs_[ordinal]);
+		}
+		++new_ordinal;
+	}
+	document_ordinal_ids_.resize(new_ordinal);
+	document_ordinal_ids_.shrink_to_fit();
+	document_ratings_.resize(new_ordinal);
+	document_ratings_.shrink_to_fit();
+	document_statuses_.resize(new_ordinal);
+	document_statuses_.shrink_to_fit();
+	document_lengths_.resize(new_ordinal);
+	document_lengths_.shrink_to_fit();
+	document_to_word_freqs_.resize(new_ordinal);
+	document_to_word_freqs_.shrink_to_fit();
 
-	if (document_to_word_freqs_.count(document_id) > 0) { document_to_word_freqs_.erase(document_id); }
+	status_documents_ = {};
+	for (int ordinal = 0; ordinal < new_ordinal; ++ordinal) {
+		const size_t status = static_cast<size_t>(document_statuses_[ordinal]);
+		if (status < DOCUMENT_STATUS_COUNT) {
+			status_documents_[status].Set(ordinal);
+		}
+	}
 
-	std::cerr << "Found duplicate document id " << document_id << std::endl;
+	if (index_mode_ == IndexMode::PLAIN) {
+		for (PostingList& postings : word_to_document_freqs_) {
+			std::vector<int> document_ordinals;
+			std::vector<double> term_freqs;
+			document_ordinals.reserve(postings.size());
+			term_freqs.reserve(postings.size());
+			for (size_t i = 0; i < postings.size(); ++i) {
+				const int ordinal = new_ordinals[postings.GetDocumentIds()[i]];
+				if (ordinal >= 0) {
+					document_ordinals.push_back(ordinal);
+					term_freqs.push_back(postings.GetTermFreqs()[i]);
+				}
+			}
+			postings = document_ordinals.empty() ? PostingList()
+				: PostingList(std::move(document_ordinals), std::move(term_freqs), postings.GetMaxTermFreq());
+		}
+	}
+	else {
+		for (CompressedPostingList& postings : compressed_postings_) {
+			CompressedPostingList renumbered;
+			postings.ForEachBlock([&](const int* document_ordinals, const uint32_t* counts, size_t size) {
+				for (size_t i = 0; i < size; ++i) {
+					const int ordinal = new_ordinals[document_ordinals[i]];
+					if (ordinal >= 0) {
+						renumbered.Append(ordinal, counts[i]);
+					}
+				}
+				});
+			postings = std::move(renumbered);
+		}
+	}
+	removed_postings_.assign(terms_.size(), 0);
 }
 
 
@@ -1,18 +1,116 @@
 #pragma once
 
 #include <stdexcept>
+#include <array>
+#include <cmath>
 #include <map>
+#include <memory_resource>
 #include <algorithm>
+#include <execution>
 #include <iostream>
 #include <set>
 #include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <type_traits>
 
 #include "string_processing.h"
 #include "document.h"
 #include "log_duration.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "compressed_posting_list.h"
+#include "top_documents.h"
+#include "index_allocator.h"
+#include "scratch_arena.h"
+#include "document_bitset.h"
+#include "score_accumulator.h"
+#include "trace_metrics.h"
+
+const size_t DOCUMENT_STATUS_COUNT = 4;
+// Sequential exhaustive search accumulates scores in an array over all ordinals
+// once the query has at least one posting per this many ordinals
+const size_t DENSE_SCORES_MAX_SPARSITY = 64;
+// Parallel exhaustive search splits the ordinals into ranges of this many, each scored by one thread.
+// A multiple of 64, so that every range starts at a word of the status bitsets.
+const int PARALLEL_SCORES_RANGE_SIZE = 1 << 14;
+// A posting list drops the postings of removed documents once they make up this share of it
+const double REMOVED_POSTINGS_COMPACTION_SHARE = 0.5;
+// Present documents are renumbered densely once removed ones hold this share of the ordinals
+const double REMOVED_ORDINALS_COMPACTION_SHARE = 0.5;
+
+enum class TopDocumentsMode {
+	// Score every matched document, then select the best ones
+	EXHAUSTIVE,
+	// Skip postings whose score upper bound cannot reach the current top results (MaxScore)
+	MAX_SCORE,
+};
+
+enum class IndexMode {
+	// Posting lists keep document ordinals and term frequencies in plain arrays
+	PLAIN,
+	// Posting lists keep delta and bit-packed blocks with raw term counts: several times smaller,
+	// at the price of decoding every scanned block
+	COMPRESSED,
+};
+
+// Document count and word document frequencies of a corpus split across several servers
+struct CorpusStatistics {
+	int document_count = 0;
+	std::map<std::string, int, std::less<>> document_freqs;
+};
+
+struct DocumentInput {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
+
+// Words point into the server's dictionary and stay valid while the server exists
+struct DocumentMatch {
+	int document_id;
+	std::vector<std::string_view> words;
+	DocumentStatus status;
+};
+
+// Resumes a paged search after the last document of the previous page
+struct SearchCursor {
+	Document last_document;
+};
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double ACCURACY = 1e-6;
+struct DocumentPage {
+	std::vector<Document> documents;
+	// Position of the next page, empty after the last one
+	std::optional<SearchCursor> next;
+};
+
+struct AddDocumentsResult {
+	struct Error {
+		int document_id;
+		std::string message;
+		// Position in the input, tells apart documents with equal ids
+		size_t document_index;
+	};
+
+	int added_count = 0;
+	// Rejected documents in input order
+	std::vector<Error> errors;
+};
+
+template <typename ExecutionPolicy>
+using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, bool>;
+
+// Predicate of the status overloads. SearchServer recognizes it and tests a precomputed bitset instead.
+struct DocumentStatusPredicate {
+	DocumentStatus status;
+
+	bool operator()(int, DocumentStatus document_status, int) const {
+		return document_status == status;
+	}
+};
 
 class SearchServer {
 public:
@@ -25,28 +123,124 @@ public:
 		}
 	}
 	explicit SearchServer(const std::string& stop_words_text)
+		: SearchServer(std::string_view(stop_words_text))
+	{
+	}
+	explicit SearchServer(std::string_view stop_words_text)
 		: SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor
 														 // from string container
 	{
 	}
 
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(const std::string& raw_query,
-		DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+		DocumentStatus status, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-	void AddDocument(int document_id, const std::string& document, DocumentStatus status,
+	template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
 		const std::vector<int>& ratings);
 
-	std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+	// Tokenizes the documents concurrently and merges them into every posting list at once.
+	// Invalid documents are skipped and reported in the result, the rest are added.
+	AddDocumentsResult AddDocuments(const std::vector<DocumentInput>& documents);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
-	std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+	// Pages are numbered from 0. Only the best (page + 1) * page_size + 1 documents are selected,
+	// the extra one tells whether a next page exists. The count saturates instead of overflowing, so
+	// a page too far to be counted is empty. Throws std::invalid_argument for page_size 0.
+	template <typename DocumentPredicate>
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t page, size_t page_size) const;
+
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, DocumentStatus status,
+		size_t page, size_t page_size) const;
+
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const;
+
+	// Continues with the documents less relevant than the cursor, selecting page_size + 1 of them however
+	// deep the page is. The query and the predicate must be those of the previous page. If the index has
+	// changed since, documents may be skipped or repeated.
+	template <typename DocumentPredicate>
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+		const SearchCursor& cursor, size_t page_size) const;
+
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, DocumentStatus status,
+		const SearchCursor& cursor, size_t page_size) const;
+
+	DocumentPage FindTopDocumentsPage(std::string_view raw_query, const SearchCursor& cursor,
+		size_t page_size) const;
+
+	// Scores documents with IDF of the whole corpus described by statistics instead of this server's own
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const CorpusStatistics& statistics, std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// Query words without stop words, sorted and deduplicated: equal results for equal texts.
+	// Throws std::invalid_argument for an invalid query, as FindTopDocuments does.
+	std::string NormalizeQuery(std::string_view raw_query) const;
+
+	// Adds the document count and the document frequencies of the query plus-words to statistics
+	void CollectQueryStatistics(std::string_view raw_query, CorpusStatistics& statistics) const;
+
+	// Copies the documents of other except the sorted excluded ids without tokenizing them again.
+	// Throws std::invalid_argument if a copied id is already present, this server is not changed then.
+	void AddDocumentsFrom(const SearchServer& other, const std::vector<int>& excluded_document_ids = {});
 
 	int GetDocumentCount() const;
 
-	const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+	bool HasDocument(int document_id) const;
+
+	// Changes whenever search results may change: on adding or removing documents and on (un)freezing IDF
+	uint64_t GetGeneration() const;
+
+	// Applies to sequential searches, parallel ones always score every matched document.
+	// MAX_SCORE needs plain posting lists, compressed ones are always scored exhaustively.
+	void SetTopDocumentsMode(TopDocumentsMode mode);
+
+	// Re-encodes every posting list, documents added later are indexed in the same mode
+	void SetIndexMode(IndexMode mode);
+
+	IndexMode GetIndexMode() const;
+
+	// Bytes held by the posting lists of the current index mode
+	size_t GetPostingsMemoryUsage() const;
+
+	// Approximate bytes held by the whole index: postings, forward index, dictionary and document data.
+	// Takes time linear in the number of words and documents.
+	size_t GetMemoryUsage() const;
+
+	// Pins IDF of the indexed words to their current values until unfrozen, for read-mostly serving.
+	// Words indexed after freezing use live values.
+	void FreezeInverseDocumentFreqs();
+
+	void UnfreezeInverseDocumentFreqs();
+
+	WordFrequencies GetWordFrequencies(int document_id) const;
+
+	// Sorted ids of the distinct words of the document, empty for an unknown id
+	const std::vector<TermId>& GetDocumentTermIds(int document_id) const;
 
 	void RemoveDocument(int document_id);
 
+	void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
+
+	// Posting lists of the document's words are updated concurrently
+	void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+
 	auto begin() const {
 		return document_ids_.begin();
 	}
@@ -55,31 +249,82 @@ public:
 		return document_ids_.end();
 	}
 
-	std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query,
+	std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query,
 		int document_id) const;
 
-private:
-	struct DocumentData {
-		int rating;
-		DocumentStatus status;
-	};
+	// Matched plus-words in sorted order, none if the document has a minus-word. The views point
+	// into the server's dictionary and stay valid while the server exists.
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&,
+		std::string_view raw_query, int document_id) const;
 
-	const std::set<std::string> stop_words_;
-	std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
-	std::map<int, int> document_ids_;
+	// Query words are looked up concurrently
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&,
+		std::string_view raw_query, int document_id) const;
 
-	std::map<int, std::map<std::string, double>> document_to_word_freqs_;
+	// Matches the query against every document in id order, parsing it once
+	std::vector<DocumentMatch> MatchAllDocuments(std::string_view raw_query) const;
 
-	bool IsStopWord(const std::string& word) const;
+	std::vector<DocumentMatch> MatchAllDocuments(const std::execution::sequenced_policy&,
+		std::string_view raw_query) const;
 
-	static bool IsValidWord(const std::string& word) {
+	// Documents are matched concurrently
+	std::vector<DocumentMatch> MatchAllDocuments(const std::execution::parallel_policy&,
+		std::string_view raw_query) const;
+
+	// Writes stop words, term dictionary, posting lists and documents to a versioned binary file.
+	// The file is replaced only once the new snapshot is complete, a failed save keeps the old one.
+	void SaveSnapshot(const std::string& path) const;
+
+	// Restores a server written by SaveSnapshot without tokenizing the documents again. The arrays are
+	// copied out of the mapped file, so the server does not depend on it afterwards.
+	// Throws std::runtime_error if the file is missing, truncated or corrupted.
+	static SearchServer LoadSnapshot(const std::string& path);
+
+private:
+	const std::set<std::string, std::less<>> stop_words_;
+	TermDictionary terms_;
+	// Indexed by term id, postings refer to document ordinals. Only the lists of the current
+	// index mode are sized, the other vector stays empty.
+	IndexMode index_mode_ = IndexMode::PLAIN;
+	std::vector<PostingList> word_to_document_freqs_;
+	std::vector<CompressedPostingList> compressed_postings_;
+	// Postings of removed documents still kept in each list, indexed by term id. Searches skip them
+	// because removed ordinals fail every document filter.
+	std::vector<uint32_t> removed_postings_;
+	// Document id to ordinal
+	IndexMap<int, int> document_ids_;
+
+	// Documents are numbered by dense ordinals in order of addition, the arrays below are indexed by them.
+	// Ordinals of removed documents stay empty until CompactOrdinals renumbers the present ones.
+	std::vector<int> document_ordinal_ids_;
+	std::vector<int> document_ratings_;
+	std::vector<DocumentStatus> document_statuses_;
+	// Word count without stop words, turns the term counts of compressed postings and of the forward index
+	// back into frequencies
+	std::vector<uint32_t> document_lengths_;
+	std::vector<DocumentTerms> document_to_word_freqs_;
+	// Ordinals of the present documents having each status
+	std::array<DocumentBitset, DOCUMENT_STATUS_COUNT> status_documents_;
+
+	TopDocumentsMode top_documents_mode_ = TopDocumentsMode::EXHAUSTIVE;
+
+	// IDF is log(document count) - log(document freq), both logarithms are kept up to date on index changes
+	double log_document_count_ = 0.0;
+	std::vector<double> log_document_freqs_;
+	bool inverse_document_freqs_frozen_ = false;
+	std::vector<double> frozen_inverse_document_freqs_;
+
+	uint64_t generation_ = 0;
+
+	bool IsStopWord(std::string_view word) const;
+
+	static bool IsValidWord(std::string_view word) {
 		return std::none_of(word.begin(), word.end(), [](char c) {
 			return c >= '\0' && c < ' ';
 			});
 	}
 
-	std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
 	static int ComputeAverageRating(const std::vector<int>& ratings) {
 		int r_s = ratings.size();
@@ -94,80 +339,502 @@ private:
 	}
 
 	struct QueryWord {
-		std::string data;
+		std::string_view data;
 		bool is_minus;
 		bool is_stop;
 	};
 
+	// The word lists and the other temporary containers of a query share its memory resource
 	struct Query {
-		std::set<std::string> plus_words;
-		std::set<std::string> minus_words;
+		explicit Query(std::pmr::memory_resource* resource)
+			: plus_words(resource)
+			, minus_words(resource) {
+		}
+
+		std::pmr::memory_resource* GetResource() const {
+			return plus_words.get_allocator().resource();
+		}
+
+		std::pmr::vector<std::string_view> plus_words;
+		std::pmr::vector<std::string_view> minus_words;
 	};
 
-	QueryWord ParseQueryWord(const std::string& text) const;
+	QueryWord ParseQueryWord(std::string_view text) const;
+
+	Query ParseQuery(std::string_view text,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+	double ComputeWordInverseDocumentFreq(TermId term_id) const;
 
-	Query ParseQuery(const std::string& text) const;
+	void UpdateDocumentFreq(TermId term_id);
 
-	double ComputeWordInverseDocumentFreq(const std::string& word) const;
+	// Sizes the posting lists and document frequencies for every interned term
+	void ResizePostings();
 
+	size_t GetDocumentFreq(TermId term_id) const;
+
+	// Searches the forward index of the document, which is much shorter than a posting list
+	bool HasPosting(TermId term_id, int document_ordinal) const;
+
+	// The ordinal must be greater than the ordinals already in the list
+	void AddPosting(TermId term_id, int document_ordinal, double term_freq);
+
+	// Calls visitor(document_ordinals, term_freqs, size) for consecutive runs of the term postings
+	template <typename Visitor>
+	void ForEachPostingsBlock(TermId term_id, Visitor visitor) const;
+
+	// Same for the postings with ordinals in [first_ordinal, last_ordinal)
+	template <typename Visitor>
+	void ForEachPostingsBlock(TermId term_id, int first_ordinal, int last_ordinal, Visitor visitor) const;
+
+	// Postings of the present documents in a plain list
+	PostingList DecodePostings(TermId term_id) const;
+
+	// Registers a document without words and returns its ordinal
+	int AddDocumentOrdinal(int document_id, DocumentStatus status, int rating, uint32_t length);
+
+	// Forgets a document, its postings stay until their lists are compacted
+	void RemoveDocumentOrdinal(int document_id, int document_ordinal);
+
+	// Counts a posting of a removed document and compacts the list once such postings are numerous.
+	// Compaction is linear in the list, but happens only after a proportional number of removals.
+	void RemovePosting(TermId term_id);
+
+	// Renumbers the present documents in their order once removed ones hold
+	// REMOVED_ORDINALS_COMPACTION_SHARE of the ordinals. Linear in the index size, like list compaction
+	// it runs only after a proportional number of removals.
+	void CompactOrdinals();
+
+	// new_postings[term_id] holds postings sorted by ordinal of documents not indexed yet.
+	// New ordinals are greater than the indexed ones, so the posting lists are only appended to.
+	void MergePostings(std::vector<std::vector<std::pair<int, double>>>& new_postings);
+
+	// Relevances of matched documents by ordinal
+	using MatchedOrdinals = std::pmr::vector<std::pair<int, double>>;
+
+	// Ids and IDF of the plus-words known to the index
+	using ScoredTerms = std::pmr::vector<std::pair<TermId, double>>;
+
+	// Documents must be sorted by ordinal
+	void EraseMinusWordDocuments(const Query& query, MatchedOrdinals& documents) const;
+
+	std::vector<Document> MakeDocuments(const MatchedOrdinals& documents) const;
+
+	// documents are sorted and hold at most one document past the page starting at first
+	static DocumentPage MakeDocumentPage(const std::vector<Document>& documents, size_t first, size_t page_size);
+
+	static void CheckPageSize(size_t page_size);
+
+	// Turns a predicate on (id, status, rating) into a predicate on ordinals
+	template <typename DocumentPredicate>
+	auto MakeOrdinalFilter(const DocumentPredicate& document_predicate) const;
+
+	// inverse_document_freq(term_id, word) gives IDF of every indexed plus-word
+	template <typename ExecutionPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindQueryTopDocuments(ExecutionPolicy&& policy, const Query& query,
+		DocumentPredicate document_predicate, size_t result_count, InverseDocumentFreq inverse_document_freq) const;
+
+	// All matched documents in ordinal order, without building a Document for each
+	template <typename DocumentPredicate, typename InverseDocumentFreq>
+	MatchedOrdinals FindAllOrdinals(const Query& query, const DocumentPredicate& document_predicate,
+		InverseDocumentFreq inverse_document_freq) const;
+
+	template <typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+		DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const;
+
+	// Ordinal ranges are scored concurrently, every one into its own accumulator without locks
+	template <typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+		DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const;
+
+	// Adds the document frequencies of the scored terms to posting_count
+	template <typename InverseDocumentFreq>
+	ScoredTerms FindScoredTerms(const Query& query, InverseDocumentFreq inverse_document_freq,
+		size_t& posting_count) const;
+
+	// Matched documents with ordinals in [first_ordinal, last_ordinal) in ordinal order. Dense scoring
+	// accumulates in an array over the range, sparse scoring in a map.
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query& query,
-		DocumentPredicate document_predicate) const;
+	MatchedOrdinals ScoreOrdinalRange(const Query& query, const ScoredTerms& terms,
+		const DocumentPredicate& document_predicate, int first_ordinal, int last_ordinal, bool dense,
+		std::pmr::memory_resource* resource) const;
+
+	template <typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindTopDocumentsMaxScore(const Query& query,
+		DocumentPredicate document_predicate, size_t result_count, InverseDocumentFreq inverse_document_freq) const;
+
+	bool HasMinusWord(const Query& query, int document_ordinal) const;
+
+	// Ids of the query words known to the index, the others cannot match
+	struct QueryTerms {
+		std::vector<TermId> plus_terms;
+		std::vector<TermId> minus_terms;
+	};
+
+	QueryTerms FindQueryTerms(const Query& query) const;
+
+	// Minus-words are checked first, a document having one needs no further lookups
+	std::vector<std::string_view> MatchQueryTerms(const QueryTerms& terms, int document_ordinal) const;
 };
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query,
-	DocumentPredicate document_predicate) const {
-	const auto query = ParseQuery(raw_query);
-	auto matched_documents = FindAllDocuments(query, document_predicate);
-	sort(matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs) {
-			return lhs.relevance > rhs.relevance
-				|| (std::abs(lhs.relevance - rhs.relevance) < ACCURACY && lhs.rating > rhs.rating);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t result_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, result_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t result_count) const {
+	TRACE_SCOPE("query");
+	ScratchScope scratch;
+	return FindQueryTopDocuments(policy, ParseQuery(raw_query, scratch.GetResource()), document_predicate, result_count,
+		[this](TermId term_id, std::string_view) {
+			return ComputeWordInverseDocumentFreq(term_id);
+		});
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+	DocumentStatus status, size_t result_count) const {
+	return FindTopDocuments(policy, raw_query, DocumentStatusPredicate{ status }, result_count);
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+	size_t page, size_t page_size) const {
+	CheckPageSize(page_size);
+	const size_t max_count = std::numeric_limits<size_t>::max();
+	const size_t first = page < max_count / page_size ? page * page_size : max_count;
+	const size_t result_count = first < max_count - page_size ? first + page_size + 1 : max_count;
+	const std::vector<Document> documents = FindTopDocuments(std::execution::seq, raw_query, document_predicate,
+		result_count);
+	return MakeDocumentPage(documents, std::min(documents.size(), first), page_size);
+}
+
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+	const SearchCursor& cursor, size_t page_size) const {
+	CheckPageSize(page_size);
+	TRACE_SCOPE("query");
+	ScratchScope scratch;
+	const auto query = ParseQuery(raw_query, scratch.GetResource());
+	const MatchedOrdinals matched_documents = FindAllOrdinals(query, document_predicate,
+		[this](TermId term_id, std::string_view) {
+			return ComputeWordInverseDocumentFreq(term_id);
 		});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+	TRACE_SCOPE("query.sort");
+	// Only the documents after the cursor compete for the page, the others were on the previous pages
+	TopDocumentsCollector collector(page_size < std::numeric_limits<size_t>::max() ? page_size + 1 : page_size,
+		matched_documents.size());
+	for (const auto& [document_ordinal, relevance] : matched_documents) {
+		const Document document{ document_ordinal_ids_[document_ordinal], relevance,
+			document_ratings_[document_ordinal] };
+		if (IsMoreRelevant(cursor.last_document, document)) {
+			collector.Push(document);
+		}
 	}
-	return matched_documents;
+	return MakeDocumentPage(collector.Extract(), 0, page_size);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query,
-	DocumentPredicate document_predicate) const {
-	std::map<int, double> document_to_relevance;
-	for (const std::string& word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+std::vector<Document> SearchServer::FindTopDocuments(const CorpusStatistics& statistics, std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t result_count) const {
+	TRACE_SCOPE("query");
+	const double log_document_count = statistics.document_count > 0 ? std::log(statistics.document_count) : 0.0;
+	ScratchScope scratch;
+	return FindQueryTopDocuments(std::execution::seq, ParseQuery(raw_query, scratch.GetResource()),
+		document_predicate, result_count,
+		[&statistics, log_document_count](TermId, std::string_view word) {
+			const auto document_freq = statistics.document_freqs.find(word);
+			if (document_freq == statistics.document_freqs.end() || document_freq->second == 0) {
+				return 0.0;
+			}
+			return log_document_count - std::log(document_freq->second);
+		});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindQueryTopDocuments(ExecutionPolicy&& policy, const Query& query,
+	DocumentPredicate document_predicate, size_t result_count, InverseDocumentFreq inverse_document_freq) const {
+	if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+		if (top_documents_mode_ == TopDocumentsMode::MAX_SCORE && index_mode_ == IndexMode::PLAIN) {
+			return FindTopDocumentsMaxScore(query, document_predicate, result_count, inverse_document_freq);
+		}
+	}
+	auto matched_documents = FindAllDocuments(policy, query, document_predicate, inverse_document_freq);
+	TRACE_SCOPE("query.sort");
+	SelectTopDocuments(policy, matched_documents, result_count);
+	return matched_documents;
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+SearchServer::MatchedOrdinals SearchServer::FindAllOrdinals(const Query& query,
+	const DocumentPredicate& document_predicate, InverseDocumentFreq inverse_document_freq) const {
+	size_t posting_count = 0;
+	const ScoredTerms terms = FindScoredTerms(query, inverse_document_freq, posting_count);
+	const bool dense = posting_count * DENSE_SCORES_MAX_SPARSITY >= document_ordinal_ids_.size();
+	return ScoreOrdinalRange(query, terms, document_predicate, 0, static_cast<int>(document_ordinal_ids_.size()),
+		dense, query.GetResource());
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+	DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const {
+	return MakeDocuments(FindAllOrdinals(query, document_predicate, inverse_document_freq));
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+	DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const {
+	size_t posting_count = 0;
+	const ScoredTerms terms = FindScoredTerms(query, inverse_document_freq, posting_count);
+	const bool dense = posting_count * DENSE_SCORES_MAX_SPARSITY >= document_ordinal_ids_.size();
+	const int ordinal_count = static_cast<int>(document_ordinal_ids_.size());
+	std::vector<int> first_ordinals;
+	for (int first_ordinal = 0; first_ordinal < ordinal_count; first_ordinal += PARALLEL_SCORES_RANGE_SIZE) {
+		first_ordinals.push_back(first_ordinal);
+	}
+	// Ranges hold disjoint documents, so their results are concatenated in ordinal order
+	std::vector<std::vector<Document>> range_documents(first_ordinals.size());
+	std::transform(std::execution::par, first_ordinals.begin(), first_ordinals.end(), range_documents.begin(),
+		[&](int first_ordinal) {
+			ScratchScope scratch;
+			return MakeDocuments(ScoreOrdinalRange(query, terms, document_predicate, first_ordinal,
+				std::min(first_ordinal + PARALLEL_SCORES_RANGE_SIZE, ordinal_count), dense, scratch.GetResource()));
+		});
+	size_t document_count = 0;
+	for (const std::vector<Document>& documents : range_documents) {
+		document_count += documents.size();
+	}
+	std::vector<Document> matched_documents;
+	matched_documents.reserve(document_count);
+	for (const std::vector<Document>& documents : range_documents) {
+		matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+	}
+	return matched_documents;
+}
+
+template <typename InverseDocumentFreq>
+SearchServer::ScoredTerms SearchServer::FindScoredTerms(const Query& query, InverseDocumentFreq inverse_document_freq,
+	size_t& posting_count) const {
+	ScoredTerms terms(query.GetResource());
+	for (const std::string_view word : query.plus_words) {
+		const auto term_id = terms_.Find(word);
+		if (!term_id) {
 			continue;
 		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
+		terms.emplace_back(*term_id, inverse_document_freq(*term_id, word));
+		posting_count += GetDocumentFreq(*term_id);
+	}
+	return terms;
+}
+
+template <typename DocumentPredicate>
+SearchServer::MatchedOrdinals SearchServer::ScoreOrdinalRange(const Query& query, const ScoredTerms& terms,
+	const DocumentPredicate& document_predicate, int first_ordinal, int last_ordinal, bool dense,
+	std::pmr::memory_resource* resource) const {
+	const auto accepts = MakeOrdinalFilter(document_predicate);
+	MatchedOrdinals matched_documents(resource);
+	if (dense) {
+		// Documents are filtered once after scoring instead of at every posting
+		DenseScoreAccumulator document_to_relevance(first_ordinal, static_cast<size_t>(last_ordinal - first_ordinal),
+			resource);
+		{
+			TRACE_SCOPE("query.scan");
+			for (const auto& [term_id, word_inverse_document_freq] : terms) {
+				ForEachPostingsBlock(term_id, first_ordinal, last_ordinal,
+					[&](const int* document_ordinals, const double* term_freqs, size_t size) {
+						document_to_relevance.Add(document_ordinals, term_freqs, size, word_inverse_document_freq);
+					});
 			}
 		}
+		TRACE_SCOPE("query.filter");
+		for (const std::string_view word : query.minus_words) {
+			if (const auto term_id = terms_.Find(word)) {
+				ForEachPostingsBlock(*term_id, first_ordinal, last_ordinal,
+					[&](const int* document_ordinals, const double*, size_t size) {
+						document_to_relevance.Exclude(document_ordinals, size);
+					});
+			}
+		}
+		if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+			static const DocumentBitset no_documents;
+			const size_t status = static_cast<size_t>(document_predicate.status);
+			const DocumentBitset& documents = status < DOCUMENT_STATUS_COUNT ? status_documents_[status] : no_documents;
+			document_to_relevance.Intersect(documents.GetWords());
+			document_to_relevance.Collect([](int) { return true; }, matched_documents);
+		}
+		else {
+			document_to_relevance.Collect(accepts, matched_documents);
+		}
+		return matched_documents;
 	}
-	for (const std::string& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+
+	std::pmr::map<int, double> document_to_relevance(resource);
+	{
+		TRACE_SCOPE("query.scan");
+		for (const auto& [term_id, word_inverse_document_freq] : terms) {
+			ForEachPostingsBlock(term_id, first_ordinal, last_ordinal,
+				[&](const int* document_ordinals, const double* term_freqs, size_t size) {
+					for (size_t i = 0; i < size; ++i) {
+						if (accepts(document_ordinals[i])) {
+							document_to_relevance[document_ordinals[i]] += term_freqs[i] * word_inverse_document_freq;
+						}
+					}
+				});
+		}
+	}
+	TRACE_SCOPE("query.filter");
+	matched_documents.assign(document_to_relevance.begin(), document_to_relevance.end());
+	EraseMinusWordDocuments(query, matched_documents);
+	return matched_documents;
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindTopDocumentsMaxScore(const Query& query,
+	DocumentPredicate document_predicate, size_t result_count, InverseDocumentFreq inverse_document_freq) const {
+	TRACE_SCOPE("query.max_score");
+	if (result_count == 0) {
+		return {};
+	}
+	const auto accepts = MakeOrdinalFilter(document_predicate);
+	struct TermCursor {
+		const PostingList* postings;
+		double inverse_document_freq;
+		double max_score;
+		size_t position;
+	};
+	std::pmr::vector<TermCursor> cursors(query.GetResource());
+	cursors.reserve(query.plus_words.size());
+	for (const std::string_view word : query.plus_words) {
+		const auto term_id = terms_.Find(word);
+		if (!term_id || word_to_document_freqs_[*term_id].empty()) {
+			continue;
+		}
+		const PostingList& postings = word_to_document_freqs_[*term_id];
+		const double word_inverse_document_freq = inverse_document_freq(*term_id, word);
+		cursors.push_back({ &postings, word_inverse_document_freq, postings.GetMaxTermFreq() * word_inverse_document_freq, 0 });
+	}
+	std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+		return lhs.max_score < rhs.max_score;
+		});
+	// bounds[i] is the best score a document can get from cursors[0..i]
+	std::pmr::vector<double> bounds(cursors.size(), query.GetResource());
+	double bound = 0.0;
+	for (size_t i = 0; i < cursors.size(); ++i) {
+		bound += cursors[i].max_score;
+		bounds[i] = bound;
+	}
+
+	TopDocumentsCollector top_documents(result_count, document_ids_.size());
+	// Documents found only in cursors before first_essential cannot enter the top
+	size_t first_essential = 0;
+	while (first_essential < cursors.size()) {
+		int document_ordinal = std::numeric_limits<int>::max();
+		bool has_candidate = false;
+		for (size_t i = first_essential; i < cursors.size(); ++i) {
+			const auto& document_ordinals = cursors[i].postings->GetDocumentIds();
+			if (cursors[i].position < document_ordinals.size()) {
+				document_ordinal = std::min(document_ordinal, document_ordinals[cursors[i].position]);
+				has_candidate = true;
+			}
+		}
+		if (!has_candidate) {
+			break;
+		}
+
+		double relevance = 0.0;
+		for (size_t i = first_essential; i < cursors.size(); ++i) {
+			TermCursor& cursor = cursors[i];
+			const auto& document_ordinals = cursor.postings->GetDocumentIds();
+			if (cursor.position < document_ordinals.size() && document_ordinals[cursor.position] == document_ordinal) {
+				relevance += cursor.postings->GetTermFreqs()[cursor.position] * cursor.inverse_document_freq;
+				++cursor.position;
+			}
+		}
+		bool pruned = false;
+		for (size_t i = first_essential; i-- > 0;) {
+			if (top_documents.IsFull() && relevance + bounds[i] < top_documents.GetThreshold() - ACCURACY) {
+				pruned = true;
+				break;
+			}
+			TermCursor& cursor = cursors[i];
+			const auto& document_ordinals = cursor.postings->GetDocumentIds();
+			cursor.position = GallopLowerBound(document_ordinals, cursor.position, document_ordinal);
+			if (cursor.position < document_ordinals.size() && document_ordinals[cursor.position] == document_ordinal) {
+				relevance += cursor.postings->GetTermFreqs()[cursor.position] * cursor.inverse_document_freq;
+			}
+		}
+		if (pruned || !accepts(document_ordinal) || HasMinusWord(query, document_ordinal)) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.erase(document_id);
+		top_documents.Push({ document_ordinal_ids_[document_ordinal], relevance, document_ratings_[document_ordinal] });
+		if (top_documents.IsFull()) {
+			while (first_essential < cursors.size()
+				&& bounds[first_essential] < top_documents.GetThreshold() - ACCURACY) {
+				++first_essential;
+			}
 		}
 	}
+	return top_documents.Extract();
+}
 
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back(
-			{ document_id, relevance, documents_.at(document_id).rating });
+template <typename Visitor>
+void SearchServer::ForEachPostingsBlock(TermId term_id, Visitor visitor) const {
+	ForEachPostingsBlock(term_id, 0, std::numeric_limits<int>::max(), visitor);
+}
+
+template <typename Visitor>
+void SearchServer::ForEachPostingsBlock(TermId term_id, int first_ordinal, int last_ordinal, Visitor visitor) const {
+	if (index_mode_ == IndexMode::PLAIN) {
+		const PostingList& postings = word_to_document_freqs_[term_id];
+		const std::vector<int>& document_ordinals = postings.GetDocumentIds();
+		const auto begin = std::lower_bound(document_ordinals.begin(), document_ordinals.end(), first_ordinal);
+		const auto end = std::lower_bound(begin, document_ordinals.end(), last_ordinal);
+		const size_t first = static_cast<size_t>(begin - document_ordinals.begin());
+		visitor(document_ordinals.data() + first, postings.GetTermFreqs().data() + first,
+			static_cast<size_t>(end - begin));
+		return;
+	}
+	compressed_postings_[term_id].ForEachBlockInRange(first_ordinal, last_ordinal,
+		[&](const int* document_ordinals, const uint32_t* counts, size_t size) {
+			double term_freqs[CompressedPostingList::BLOCK_SIZE];
+			for (size_t i = 0; i < size; ++i) {
+				term_freqs[i] = static_cast<double>(counts[i]) / document_lengths_[document_ordinals[i]];
+			}
+			visitor(document_ordinals, static_cast<const double*>(term_freqs), size);
+		});
+}
+
+template <typename DocumentPredicate>
+auto SearchServer::MakeOrdinalFilter(const DocumentPredicate& document_predicate) const {
+	if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+		static const DocumentBitset no_documents;
+		const size_t status = static_cast<size_t>(document_predicate.status);
+		const DocumentBitset& documents = status < DOCUMENT_STATUS_COUNT ? status_documents_[status] : no_documents;
+		return [&documents](int document_ordinal) {
+			return documents.Test(document_ordinal);
+		};
+	}
+	else {
+		return [this, &document_predicate](int document_ordinal) {
+			return document_ordinal_ids_[document_ordinal] >= 0 && document_predicate(document_ordinal_ids_[document_ordinal],
+				document_statuses_[document_ordinal], document_ratings_[document_ordinal]);
+		};
 	}
-	return matched_documents;
 }
 
-void AddDocument(SearchServer& search_server, int document_id, const std::string& document,
+void AddDocument(SearchServer& search_server, int document_id, std::string_view document,
 	DocumentStatus status, const std::vector<int>& ratings);
 
-void FindTopDocuments(const SearchServer& search_server, const std::string& raw_query);
+void FindTopDocuments(const SearchServer& search_server, std::string_view raw_query);
 
-void MatchDocuments(const SearchServer& search_server, const std::string& query);
+void MatchDocuments(const SearchServer& search_server, std::string_view query);
 
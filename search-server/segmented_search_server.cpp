@@ -0,0 +1,221 @@
+#include "segmented_search_server.h"
+
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text, size_t write_segment_capacity,
+	size_t merge_factor)
+	: empty_segment_(stop_words_text)
+	, write_segment_capacity_(write_segment_capacity)
+	, merge_factor_(merge_factor)
+	, write_segment_(std::make_unique<SearchServer>(empty_segment_))
+	, segments_(std::make_shared<const Segments>()) {
+	if (write_segment_capacity_ == 0) {
+		throw std::invalid_argument("Write segment capacity must be positive");
+	}
+	if (merge_factor_ < 2) {
+		throw std::invalid_argument("Merge factor must be at least 2");
+	}
+	compaction_thread_ = std::thread([this] {
+		RunCompaction();
+		});
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+	{
+		std::lock_guard<std::mutex> guard(compaction_mutex_);
+		stopping_ = true;
+	}
+	compaction_requested_.notify_one();
+	compaction_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	std::lock_guard<std::mutex> guard(write_mutex_);
+	if (document_ids_.count(document_id) > 0) {
+		throw std::invalid_argument("Invalid document_id");
+	}
+	write_segment_->AddDocument(document_id, document, status, ratings);
+	write_segment_ids_.insert(document_id);
+	document_ids_.insert(document_id);
+	if (static_cast<size_t>(write_segment_->GetDocumentCount()) >= write_segment_capacity_) {
+		Seal();
+	}
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+	std::lock_guard<std::mutex> guard(write_mutex_);
+	if (write_segment_ids_.erase(document_id) > 0) {
+		write_segment_->RemoveDocument(document_id);
+		document_ids_.erase(document_id);
+		return;
+	}
+	if (document_ids_.erase(document_id) == 0) {
+		return;
+	}
+	bool rewrite_due = false;
+	segments_.Update([document_id, &rewrite_due](Segments& segments) {
+		// Older segments may still store removed copies of the id, only one segment holds it unremoved
+		for (Segment& segment : segments.sealed) {
+			const std::vector<int>& removed_ids = *segment.removed_ids;
+			const auto position = std::lower_bound(removed_ids.begin(), removed_ids.end(), document_id);
+			if ((position != removed_ids.end() && *position == document_id)
+				|| !segment.documents->HasDocument(document_id)) {
+				continue;
+			}
+			auto next_removed_ids = std::make_shared<std::vector<int>>();
+			next_removed_ids->reserve(removed_ids.size() + 1);
+			next_removed_ids->insert(next_removed_ids->end(), removed_ids.begin(), position);
+			next_removed_ids->push_back(document_id);
+			next_removed_ids->insert(next_removed_ids->end(), position, removed_ids.end());
+			rewrite_due = next_removed_ids->size()
+				>= segment.documents->GetDocumentCount() * MAX_SEGMENT_REMOVED_SHARE;
+			segment.removed_ids = std::move(next_removed_ids);
+			return;
+		}
+		});
+	if (rewrite_due) {
+		RequestCompaction();
+	}
+}
+
+void SegmentedSearchServer::Flush() {
+	std::lock_guard<std::mutex> guard(write_mutex_);
+	Seal();
+}
+
+void SegmentedSearchServer::Compact() {
+	while (MergeOnce()) {
+	}
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+	size_t result_count) const {
+	return FindTopDocuments(raw_query, DocumentStatusPredicate{ status }, result_count);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+	const auto segments = segments_.Load();
+	int document_count = 0;
+	for (const Segment& segment : segments->sealed) {
+		document_count += segment.documents->GetDocumentCount() - static_cast<int>(segment.removed_ids->size());
+	}
+	return document_count;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+	return segments_.Load()->sealed.size();
+}
+
+uint64_t SegmentedSearchServer::GetEpoch() const {
+	return segments_.GetEpoch();
+}
+
+void SegmentedSearchServer::Seal() {
+	if (write_segment_->GetDocumentCount() == 0) {
+		return;
+	}
+	Segment sealed{ std::move(write_segment_), std::make_shared<const std::vector<int>>() };
+	write_segment_ = std::make_unique<SearchServer>(empty_segment_);
+	write_segment_ids_.clear();
+	segments_.Update([&sealed](Segments& segments) {
+		segments.sealed.push_back(sealed);
+		});
+	RequestCompaction();
+}
+
+void SegmentedSearchServer::RequestCompaction() {
+	{
+		std::lock_guard<std::mutex> guard(compaction_mutex_);
+		compaction_pending_ = true;
+	}
+	compaction_requested_.notify_one();
+}
+
+// Tier 0 holds segments smaller than merge_factor write segments, every next tier is merge_factor times larger
+size_t SegmentedSearchServer::GetTier(const SearchServer& segment) const {
+	const size_t document_count = segment.GetDocumentCount();
+	size_t tier = 0;
+	for (size_t size = write_segment_capacity_ * merge_factor_; document_count >= size; size *= merge_factor_) {
+		++tier;
+	}
+	return tier;
+}
+
+bool SegmentedSearchServer::MergeOnce() {
+	std::lock_guard<std::mutex> merge_guard(merge_mutex_);
+	const auto segments = segments_.Load();
+	std::map<size_t, std::vector<Segment>> tiers;
+	for (const Segment& segment : segments->sealed) {
+		tiers[GetTier(*segment.documents)].push_back(segment);
+	}
+	const auto due_tier = std::find_if(tiers.begin(), tiers.end(), [this](const auto& tier) {
+		return tier.second.size() >= merge_factor_;
+		});
+	if (due_tier != tiers.end()) {
+		MergeSegments({ due_tier->second.begin(), due_tier->second.begin() + merge_factor_ });
+		return true;
+	}
+	const auto rewrite_due = std::find_if(segments->sealed.begin(), segments->sealed.end(), [](const Segment& segment) {
+		return !segment.removed_ids->empty()
+			&& segment.removed_ids->size() >= segment.documents->GetDocumentCount() * MAX_SEGMENT_REMOVED_SHARE;
+		});
+	if (rewrite_due != segments->sealed.end()) {
+		MergeSegments({ *rewrite_due });
+		return true;
+	}
+	return false;
+}
+
+void SegmentedSearchServer::MergeSegments(const std::vector<Segment>& merged_segments) {
+	auto merged = std::make_shared<SearchServer>(empty_segment_);
+	for (const Segment& segment : merged_segments) {
+		merged->AddDocumentsFrom(*segment.documents, *segment.removed_ids);
+	}
+
+	segments_.Replace([&](const std::shared_ptr<const Segments>& current) {
+		auto next = std::make_shared<Segments>();
+		// Documents removed while merging are still stored in the merged segment
+		auto merged_removed_ids = std::make_shared<std::vector<int>>();
+		for (const Segment& segment : current->sealed) {
+			const auto merged_segment = std::find_if(merged_segments.begin(), merged_segments.end(),
+				[&segment](const Segment& merged_segment) {
+					return merged_segment.documents == segment.documents;
+				});
+			if (merged_segment == merged_segments.end()) {
+				next->sealed.push_back(segment);
+				continue;
+			}
+			std::set_difference(segment.removed_ids->begin(), segment.removed_ids->end(),
+				merged_segment->removed_ids->begin(), merged_segment->removed_ids->end(),
+				std::back_inserter(*merged_removed_ids));
+		}
+		std::sort(merged_removed_ids->begin(), merged_removed_ids->end());
+		if (merged->GetDocumentCount() > 0) {
+			next->sealed.push_back({ std::move(merged), std::move(merged_removed_ids) });
+		}
+		return std::shared_ptr<const Segments>(std::move(next));
+		});
+}
+
+void SegmentedSearchServer::RunCompaction() {
+	std::unique_lock<std::mutex> lock(compaction_mutex_);
+	while (true) {
+		compaction_requested_.wait(lock, [this] {
+			return compaction_pending_ || stopping_;
+			});
+		if (stopping_) {
+			return;
+		}
+		compaction_pending_ = false;
+		lock.unlock();
+		Compact();
+		lock.lock();
+	}
+}
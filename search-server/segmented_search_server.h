@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "search_server.h"
+#include "versioned_ptr.h"
+
+const size_t DEFAULT_WRITE_SEGMENT_CAPACITY = 4096;
+const size_t DEFAULT_MERGE_FACTOR = 4;
+// A sealed segment is rewritten without its removed documents once they make up this share of it
+const double MAX_SEGMENT_REMOVED_SHARE = 0.25;
+
+// Log-structured index for high ingestion rates. New documents go to a small write segment, so adding
+// one costs the same however large the corpus is. A full write segment is sealed into an immutable
+// segment, and a background thread merges every merge_factor sealed segments of similar size into one.
+// Removed documents are hidden by tombstones of their segment until the segment is merged or rewritten,
+// and their ids can be added again at once.
+//
+// Queries see the sealed segments only: documents become searchable when their write segment is sealed,
+// either because it is full or on Flush. Every segment is scored with IDF of all sealed segments together,
+// counting removed documents until they are dropped from their segment.
+class SegmentedSearchServer {
+public:
+	explicit SegmentedSearchServer(std::string_view stop_words_text,
+		size_t write_segment_capacity = DEFAULT_WRITE_SEGMENT_CAPACITY, size_t merge_factor = DEFAULT_MERGE_FACTOR);
+
+	SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+	SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+	~SegmentedSearchServer();
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	// Seals the write segment, making its documents searchable
+	void Flush();
+
+	// Runs the due merges and rewrites in the calling thread
+	void Compact();
+
+	// Segments are searched concurrently, so document_predicate must be safe to call from several threads
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	// Number of searchable documents
+	int GetDocumentCount() const;
+
+	size_t GetSegmentCount() const;
+
+	// Number of versions of the segment list published so far
+	uint64_t GetEpoch() const;
+
+private:
+	struct Segment {
+		std::shared_ptr<const SearchServer> documents;
+		// Sorted ids of the removed documents that the segment still stores
+		std::shared_ptr<const std::vector<int>> removed_ids;
+	};
+
+	struct Segments {
+		std::vector<Segment> sealed;
+	};
+
+	// Holds only the stop words: new write segments are copied from it, and queries are validated by it
+	const SearchServer empty_segment_;
+	const size_t write_segment_capacity_;
+	const size_t merge_factor_;
+
+	std::mutex write_mutex_;
+	std::unique_ptr<SearchServer> write_segment_;
+	std::set<int> write_segment_ids_;
+	// Ids of the documents that are not removed, sealed or not
+	std::unordered_set<int> document_ids_;
+
+	VersionedPtr<Segments> segments_;
+
+	// Merges and rewrites are serialized, so they never race for the same segments
+	std::mutex merge_mutex_;
+
+	std::mutex compaction_mutex_;
+	std::condition_variable compaction_requested_;
+	bool compaction_pending_ = false;
+	bool stopping_ = false;
+	std::thread compaction_thread_;
+
+	// Requires write_mutex_
+	void Seal();
+
+	void RequestCompaction();
+
+	size_t GetTier(const SearchServer& segment) const;
+
+	// Returns false if no merge or rewrite is due
+	bool MergeOnce();
+
+	// Replaces the segments by one holding their documents that are not removed
+	void MergeSegments(const std::vector<Segment>& merged_segments);
+
+	void RunCompaction();
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t result_count) const {
+	const auto segments = segments_.Load();
+	CorpusStatistics statistics;
+	// Throws on an invalid query even if there are no segments yet
+	empty_segment_.CollectQueryStatistics(raw_query, statistics);
+	for (const Segment& segment : segments->sealed) {
+		segment.documents->CollectQueryStatistics(raw_query, statistics);
+	}
+
+	std::vector<std::vector<Document>> segment_documents(segments->sealed.size());
+	std::transform(std::execution::par, segments->sealed.begin(), segments->sealed.end(), segment_documents.begin(),
+		[&](const Segment& segment) {
+			const std::vector<int>& removed_ids = *segment.removed_ids;
+			// Keeps the status bitset path of DocumentStatusPredicate for segments without removed documents
+			if (removed_ids.empty()) {
+				return segment.documents->FindTopDocuments(statistics, raw_query, document_predicate, result_count);
+			}
+			const auto is_alive = [&](int document_id, DocumentStatus status, int rating) {
+				return !std::binary_search(removed_ids.begin(), removed_ids.end(), document_id)
+					&& document_predicate(document_id, status, rating);
+			};
+			return segment.documents->FindTopDocuments(statistics, raw_query, is_alive, result_count);
+		});
+
+	std::vector<Document> matched_documents;
+	for (const auto& documents : segment_documents) {
+		matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+	}
+	SelectTopDocuments(std::execution::seq, matched_documents, result_count);
+	return matched_documents;
+}
@@ -0,0 +1,88 @@
+#include "sharded_search_server.h"
+
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count)
+	: shards_(shard_count, SearchServer(stop_words_text)) {
+	if (shards_.empty()) {
+		throw std::invalid_argument("Shard count must be positive");
+	}
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+AddDocumentsResult ShardedSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+	std::vector<std::vector<DocumentInput>> shard_documents(shards_.size());
+	// Input positions of the documents of every shard
+	std::vector<std::vector<size_t>> shard_positions(shards_.size());
+	for (size_t i = 0; i < documents.size(); ++i) {
+		const size_t shard_index = GetShardIndex(documents[i].id);
+		shard_documents[shard_index].push_back(documents[i]);
+		shard_positions[shard_index].push_back(i);
+	}
+
+	std::vector<AddDocumentsResult> shard_results(shards_.size());
+	std::vector<size_t> shard_indexes(shards_.size());
+	std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+	std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(), [&](size_t shard_index) {
+		shard_results[shard_index] = shards_[shard_index].AddDocuments(shard_documents[shard_index]);
+		});
+
+	AddDocumentsResult result;
+	for (size_t shard_index = 0; shard_index < shards_.size(); ++shard_index) {
+		result.added_count += shard_results[shard_index].added_count;
+		for (AddDocumentsResult::Error& error : shard_results[shard_index].errors) {
+			error.document_index = shard_positions[shard_index][error.document_index];
+			result.errors.push_back(std::move(error));
+		}
+	}
+	std::sort(result.errors.begin(), result.errors.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.document_index < rhs.document_index;
+		});
+	return result;
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+	size_t result_count) const {
+	return FindTopDocuments(raw_query, DocumentStatusPredicate{ status }, result_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+	std::string_view raw_query, int document_id) const {
+	return shards_[GetShardIndex(document_id)].MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	int document_count = 0;
+	for (const SearchServer& shard : shards_) {
+		document_count += shard.GetDocumentCount();
+	}
+	return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	// Sequential ids are spread evenly whatever the shard count is
+	const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15;
+	return static_cast<size_t>(hash >> 32) % shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard_index) const {
+	return shards_.at(shard_index);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_server.h"
+
+// Documents partitioned by id hash across independent SearchServer shards. Queries are fanned out to
+// the shards in parallel and scored with IDF of all shards together, so results equal those of a single
+// server holding every document. A document id always maps to the same shard, which checks it.
+// Like SearchServer, updates must not run concurrently with other calls.
+class ShardedSearchServer {
+public:
+	// Throws std::invalid_argument if shard_count is 0 or a stop word is invalid
+	ShardedSearchServer(std::string_view stop_words_text, size_t shard_count);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	// Shards add their documents concurrently. Errors are reported in input order.
+	AddDocumentsResult AddDocuments(const std::vector<DocumentInput>& documents);
+
+	void RemoveDocument(int document_id);
+
+	// Shards are searched concurrently, so document_predicate must be safe to call from several threads
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	// Throws std::out_of_range for an unknown id
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
+		int document_id) const;
+
+	int GetDocumentCount() const;
+
+	size_t GetShardCount() const;
+
+	size_t GetShardIndex(int document_id) const;
+
+	const SearchServer& GetShard(size_t shard_index) const;
+
+private:
+	std::vector<SearchServer> shards_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t result_count) const {
+	CorpusStatistics statistics;
+	for (const SearchServer& shard : shards_) {
+		shard.CollectQueryStatistics(raw_query, statistics);
+	}
+
+	// Every shard keeps its own best result_count, the global best are among them
+	std::vector<std::vector<Document>> shard_documents(shards_.size());
+	std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(),
+		[&](const SearchServer& shard) {
+			return shard.FindTopDocuments(statistics, raw_query, document_predicate, result_count);
+		});
+
+	std::vector<Document> matched_documents;
+	for (const auto& documents : shard_documents) {
+		matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+	}
+	SelectTopDocuments(std::execution::seq, matched_documents, result_count);
+	return matched_documents;
+}
@@ -0,0 +1,232 @@
+#include "snapshot_io.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'S', 'S', 'R', 'V', 'S', 'N', 'A', 'P' };
+const size_t SNAPSHOT_HEADER_SIZE = 32;
+const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t payload_size;
+	uint64_t checksum;
+};
+static_assert(sizeof(SnapshotHeader) == SNAPSHOT_HEADER_SIZE);
+
+}  // namespace
+
+SnapshotChecksum::SnapshotChecksum() {
+	for (size_t i = 0; i < lanes_.size(); ++i) {
+		lanes_[i] = FNV_OFFSET_BASIS + i;
+	}
+}
+
+void SnapshotChecksum::Update(const char* data, size_t size) {
+	// An empty array passes the null data() of its vector, which memcpy must not get
+	if (size == 0) {
+		return;
+	}
+	if (pending_size_ > 0) {
+		const size_t copied = std::min(size, STRIPE_SIZE - pending_size_);
+		std::memcpy(pending_ + pending_size_, data, copied);
+		pending_size_ += copied;
+		data += copied;
+		size -= copied;
+		if (pending_size_ < STRIPE_SIZE) {
+			return;
+		}
+		UpdateStripe(pending_);
+		pending_size_ = 0;
+	}
+	for (; size >= STRIPE_SIZE; data += STRIPE_SIZE, size -= STRIPE_SIZE) {
+		UpdateStripe(data);
+	}
+	if (size > 0) {
+		std::memcpy(pending_, data, size);
+		pending_size_ = size;
+	}
+}
+
+uint64_t SnapshotChecksum::GetValue() const {
+	uint64_t checksum = FNV_OFFSET_BASIS;
+	for (const uint64_t lane : lanes_) {
+		checksum ^= lane;
+		checksum *= FNV_PRIME;
+	}
+	for (size_t i = 0; i < pending_size_; ++i) {
+		checksum ^= static_cast<unsigned char>(pending_[i]);
+		checksum *= FNV_PRIME;
+	}
+	return checksum;
+}
+
+void SnapshotChecksum::UpdateStripe(const char* stripe) {
+	for (size_t i = 0; i < lanes_.size(); ++i) {
+		uint64_t word;
+		std::memcpy(&word, stripe + i * sizeof(uint64_t), sizeof(word));
+		lanes_[i] ^= word;
+		lanes_[i] *= FNV_PRIME;
+	}
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+	: path_(path)
+	, temp_path_(path + ".tmp")
+	, out_(temp_path_, std::ios::binary | std::ios::trunc) {
+	if (!out_) {
+		throw std::runtime_error("Cannot open snapshot " + temp_path_ + " for writing");
+	}
+	const SnapshotHeader placeholder{};
+	out_.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+}
+
+void SnapshotWriter::WriteString(std::string_view text) {
+	Write<uint32_t>(static_cast<uint32_t>(text.size()));
+	WriteBytes(text.data(), text.size());
+}
+
+void SnapshotWriter::Finish() {
+	SnapshotHeader header{};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	header.payload_size = payload_size_;
+	header.checksum = checksum_.GetValue();
+	out_.seekp(0);
+	out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out_.close();
+	if (!out_) {
+		throw std::runtime_error("Failed to write snapshot");
+	}
+#ifdef _WIN32
+	// rename does not replace an existing file there
+	std::remove(path_.c_str());
+#endif
+	if (std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+		throw std::runtime_error("Cannot replace snapshot " + path_);
+	}
+	finished_ = true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	if (!finished_) {
+		out_.close();
+		std::remove(temp_path_.c_str());
+	}
+}
+
+void SnapshotWriter::WriteBytes(const void* data, size_t size) {
+	if (size == 0) {
+		return;
+	}
+	const char* bytes = static_cast<const char*>(data);
+	checksum_.Update(bytes, size);
+	payload_size_ += size;
+	out_.write(bytes, size);
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) {
+	size_t file_size = 0;
+#ifndef _WIN32
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Cannot open snapshot " + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw std::runtime_error("Cannot stat snapshot " + path);
+	}
+	file_size = static_cast<size_t>(file_stat.st_size);
+	if (file_size > 0) {
+		void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Cannot map snapshot " + path);
+		}
+		madvise(mapping, file_size, MADV_SEQUENTIAL);
+		mapping_ = mapping;
+		mapping_size_ = file_size;
+		data_ = static_cast<const char*>(mapping);
+	}
+	close(fd);
+#else
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) {
+		throw std::runtime_error("Cannot open snapshot " + path);
+	}
+	file_size = static_cast<size_t>(in.tellg());
+	buffer_.resize(file_size);
+	in.seekg(0);
+	in.read(buffer_.data(), file_size);
+	data_ = buffer_.data();
+#endif
+	if (file_size < SNAPSHOT_HEADER_SIZE) {
+		Unmap();
+		throw std::runtime_error("Snapshot is truncated");
+	}
+	SnapshotHeader header;
+	std::memcpy(&header, data_, sizeof(header));
+	std::string error;
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+		error = "File is not a search server snapshot";
+	}
+	else if (header.version != SNAPSHOT_VERSION) {
+		error = "Unsupported snapshot version " + std::to_string(header.version);
+	}
+	else if (header.payload_size != file_size - SNAPSHOT_HEADER_SIZE) {
+		error = "Snapshot is truncated";
+	}
+	else {
+		SnapshotChecksum checksum;
+		checksum.Update(data_ + SNAPSHOT_HEADER_SIZE, header.payload_size);
+		if (checksum.GetValue() != header.checksum) {
+			error = "Snapshot checksum mismatch";
+		}
+	}
+	if (!error.empty()) {
+		Unmap();
+		throw std::runtime_error(error);
+	}
+	data_ += SNAPSHOT_HEADER_SIZE;
+	size_ = header.payload_size;
+}
+
+SnapshotReader::~SnapshotReader() {
+	Unmap();
+}
+
+void SnapshotReader::Unmap() {
+#ifndef _WIN32
+	if (mapping_ != nullptr) {
+		munmap(mapping_, mapping_size_);
+		mapping_ = nullptr;
+	}
+#endif
+}
+
+std::string_view SnapshotReader::ReadString() {
+	const uint32_t size = Read<uint32_t>();
+	return { ReadBytes(size), size };
+}
+
+const char* SnapshotReader::ReadBytes(size_t size) {
+	if (size > size_ - position_) {
+		throw std::runtime_error("Snapshot is truncated");
+	}
+	const char* bytes = data_ + position_;
+	position_ += size;
+	return bytes;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Snapshot file: 32-byte header (magic, version, payload size, SnapshotChecksum of the payload)
+// followed by the payload. Values are stored in native byte order.
+const uint32_t SNAPSHOT_VERSION = 5;
+
+// FNV-1a 64 over 64-bit words in four interleaved lanes, so that the multiplications of neighboring
+// words do not wait for each other. Bytes past the last 32-byte stripe are hashed one by one.
+// Chunks may be split anywhere, the result depends only on the concatenated bytes.
+class SnapshotChecksum {
+public:
+	SnapshotChecksum();
+
+	void Update(const char* data, size_t size);
+
+	uint64_t GetValue() const;
+
+private:
+	static const size_t STRIPE_SIZE = 32;
+
+	std::array<uint64_t, STRIPE_SIZE / sizeof(uint64_t)> lanes_;
+	char pending_[STRIPE_SIZE];
+	size_t pending_size_ = 0;
+
+	void UpdateStripe(const char* stripe);
+};
+
+// Writes to path + ".tmp" and renames it over path on Finish, so a failed save keeps the old snapshot
+class SnapshotWriter {
+public:
+	explicit SnapshotWriter(const std::string& path);
+	// Removes the temporary file unless Finish succeeded
+	~SnapshotWriter();
+
+	template <typename T>
+	void Write(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		WriteBytes(&value, sizeof(T));
+	}
+
+	// Element count followed by the raw elements
+	template <typename T>
+	void WriteArray(const std::vector<T>& values) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		Write<uint64_t>(values.size());
+		WriteBytes(values.data(), values.size() * sizeof(T));
+	}
+
+	void WriteString(std::string_view text);
+
+	// Completes the header and replaces the snapshot at path.
+	// Throws std::runtime_error if anything failed to be written.
+	void Finish();
+
+private:
+	const std::string path_;
+	const std::string temp_path_;
+	bool finished_ = false;
+	std::ofstream out_;
+	uint64_t payload_size_ = 0;
+	SnapshotChecksum checksum_;
+
+	void WriteBytes(const void* data, size_t size);
+};
+
+// Maps a snapshot file read-only and checks its header and checksum
+class SnapshotReader {
+public:
+	explicit SnapshotReader(const std::string& path);
+	~SnapshotReader();
+
+	SnapshotReader(const SnapshotReader&) = delete;
+	SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+	template <typename T>
+	T Read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value;
+		std::memcpy(&value, ReadBytes(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	std::vector<T> ReadArray() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		const uint64_t size = Read<uint64_t>();
+		if (size > (size_ - position_) / sizeof(T)) {
+			throw std::runtime_error("Snapshot is truncated");
+		}
+		std::vector<T> values(size);
+		const char* bytes = ReadBytes(size * sizeof(T));
+		// memcpy must not get the null data() of an empty vector
+		if (size > 0) {
+			std::memcpy(values.data(), bytes, size * sizeof(T));
+		}
+		return values;
+	}
+
+	// The view points into the mapping and lives as long as the reader
+	std::string_view ReadString();
+
+	bool AtEnd() const {
+		return position_ == size_;
+	}
+
+private:
+	void* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+	std::vector<char> buffer_;
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	size_t position_ = 0;
+
+	const char* ReadBytes(size_t size);
+
+	void Unmap();
+};
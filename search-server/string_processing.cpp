@@ -1,22 +1,10 @@
 //Вставьте сюда своё решение из урока «‎Очередь запросов».‎
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-	std::vector<std::string> words;
-	std::string word;
-	for (const char c : text) {
-		if (c == ' ') {
-			if (!word.empty()) {
-				words.push_back(word);
-				word.clear();
-			}
-		}
-		else {
-			word += c;
-		}
-	}
-	if (!word.empty()) {
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+	std::vector<std::string_view> words;
+	ForEachWord(text, [&words](std::string_view word) {
 		words.push_back(word);
-	}
+		});
 	return words;
 }
\ No newline at end of file
@@ -2,16 +2,32 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
 #include <set>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+// Calls action for every space-separated word of text without collecting them
+template <typename Action>
+void ForEachWord(std::string_view text, Action action) {
+	while (!text.empty()) {
+		const size_t word_begin = text.find_first_not_of(' ');
+		if (word_begin == text.npos) {
+			break;
+		}
+		text.remove_prefix(word_begin);
+		const size_t word_end = text.find(' ');
+		action(text.substr(0, word_end));
+		text.remove_prefix(word_end == text.npos ? text.size() : word_end);
+	}
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-	std::set<std::string> non_empty_strings;
-	for (const std::string& str : strings) {
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+	std::set<std::string, std::less<>> non_empty_strings;
+	for (const std::string_view str : strings) {
 		if (!str.empty()) {
-			non_empty_strings.insert(str);
+			non_empty_strings.emplace(str);
 		}
 	}
 	return non_empty_strings;
@@ -0,0 +1,75 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+	: words_(other.words_) {
+	ids_.reserve(words_.size());
+	for (TermId term_id = 0; term_id < words_.size(); ++term_id) {
+		ids_.emplace(words_[term_id], term_id);
+	}
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+	if (this != &other) {
+		TermDictionary copy(other);
+		*this = std::move(copy);
+	}
+	return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+	if (const auto it = ids_.find(word); it != ids_.end()) {
+		return it->second;
+	}
+	const TermId term_id = static_cast<TermId>(words_.size());
+	const std::string_view stored_word = words_.emplace_back(word);
+	ids_.emplace(stored_word, term_id);
+	return term_id;
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view word) const {
+	if (const auto it = ids_.find(word); it != ids_.end()) {
+		return it->second;
+	}
+	return std::nullopt;
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+	const size_t inline_capacity = std::string().capacity();
+	// A word costs its string, a hash map node and a bucket, long words also a heap buffer
+	size_t memory_usage = sizeof(*this) + ids_.bucket_count() * sizeof(void*);
+	for (const std::string& word : words_) {
+		memory_usage += sizeof(std::string) + sizeof(std::pair<const std::string_view, TermId>) + sizeof(void*);
+		if (word.capacity() > inline_capacity) {
+			memory_usage += word.capacity() + 1;
+		}
+	}
+	return memory_usage;
+}
+
+size_t WordFrequencies::count(std::string_view word) const {
+	return FindIndex(word) ? 1 : 0;
+}
+
+double WordFrequencies::at(std::string_view word) const {
+	const auto index = FindIndex(word);
+	if (!index) {
+		throw std::out_of_range("Word is not in the document");
+	}
+	return ComputeTermFreq(document_->term_counts[*index], length_);
+}
+
+std::optional<size_t> WordFrequencies::FindIndex(std::string_view word) const {
+	const auto term_id = terms_->Find(word);
+	if (!term_id) {
+		return std::nullopt;
+	}
+	const auto& term_ids = document_->term_ids;
+	const auto it = std::lower_bound(term_ids.begin(), term_ids.end(), *term_id);
+	if (it == term_ids.end() || *it != *term_id) {
+		return std::nullopt;
+	}
+	return static_cast<size_t>(it - term_ids.begin());
+}
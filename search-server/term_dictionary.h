@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Interns every distinct word once and assigns it a dense id in registration order
+class TermDictionary {
+public:
+	TermDictionary() = default;
+
+	// Keys of ids_ view into words_, so a copy re-keys them on its own storage
+	TermDictionary(const TermDictionary& other);
+	TermDictionary& operator=(const TermDictionary& other);
+
+	// Moving a deque keeps its elements in place, so the views stay valid
+	TermDictionary(TermDictionary&&) = default;
+	TermDictionary& operator=(TermDictionary&&) = default;
+
+	TermId Intern(std::string_view word);
+
+	std::optional<TermId> Find(std::string_view word) const;
+
+	std::string_view GetWord(TermId term_id) const {
+		return words_[term_id];
+	}
+
+	size_t size() const {
+		return words_.size();
+	}
+
+	// Approximate bytes of the words and the hash map
+	size_t GetMemoryUsage() const;
+
+private:
+	// deque never relocates its elements, so views into the stored strings stay valid
+	std::deque<std::string> words_;
+	std::unordered_map<std::string_view, TermId> ids_;
+};
+
+// Forward index entry of a document, sorted by term id. Frequencies are not stored: the counts and the
+// document length give them back, which halves the entry and matches the compressed postings.
+struct DocumentTerms {
+	std::vector<TermId> term_ids;
+	std::vector<uint32_t> term_counts;
+};
+
+// Adds 1 / length once per occurrence, exactly as frequencies are summed while tokenizing
+inline double ComputeTermFreq(uint32_t count, uint32_t length) {
+	const double inv_word_count = 1.0 / length;
+	double term_freq = 0.0;
+	for (uint32_t i = 0; i < count; ++i) {
+		term_freq += inv_word_count;
+	}
+	return term_freq;
+}
+
+// Read-only (word, frequency) view of a document kept for GetWordFrequencies callers
+class WordFrequencies {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<std::string_view, double>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		Iterator(const WordFrequencies* frequencies, size_t index)
+			: frequencies_(frequencies)
+			, index_(index) {
+		}
+
+		value_type operator*() const {
+			return { frequencies_->terms_->GetWord(frequencies_->document_->term_ids[index_]),
+				ComputeTermFreq(frequencies_->document_->term_counts[index_], frequencies_->length_) };
+		}
+		Iterator& operator++() {
+			++index_;
+			return *this;
+		}
+		bool operator==(const Iterator& other) const {
+			return index_ == other.index_;
+		}
+		bool operator!=(const Iterator& other) const {
+			return index_ != other.index_;
+		}
+
+	private:
+		const WordFrequencies* frequencies_;
+		size_t index_;
+	};
+
+	// length is the word count of the document without stop words
+	WordFrequencies(const TermDictionary& terms, const DocumentTerms& document, uint32_t length)
+		: terms_(&terms)
+		, document_(&document)
+		, length_(length) {
+	}
+
+	Iterator begin() const {
+		return Iterator(this, 0);
+	}
+	Iterator end() const {
+		return Iterator(this, size());
+	}
+	size_t size() const {
+		return document_->term_ids.size();
+	}
+	bool empty() const {
+		return document_->term_ids.empty();
+	}
+
+	size_t count(std::string_view word) const;
+
+	// Throws std::out_of_range if the document does not contain the word
+	double at(std::string_view word) const;
+
+private:
+	const TermDictionary* terms_;
+	const DocumentTerms* document_;
+	uint32_t length_;
+
+	std::optional<size_t> FindIndex(std::string_view word) const;
+};
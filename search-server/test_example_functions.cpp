@@ -0,0 +1,241 @@
+#include "test_example_functions.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+#include "segmented_search_server.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+void AssertImpl(bool value, const std::string& expr_str, const std::string& file, int line, const std::string& hint) {
+	if (!value) {
+		std::cerr << file << "(" << line << "): ASSERT(" << expr_str << ") failed."s;
+		if (!hint.empty()) {
+			std::cerr << " Hint: "s << hint;
+		}
+		std::cerr << std::endl;
+		std::abort();
+	}
+}
+
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __LINE__, (hint))
+
+std::string MakeTestDocument(int id) {
+	const std::vector<std::string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s,
+		"hair"s, "tail"s, "collar"s, "big"s, "small"s };
+	std::string text;
+	for (int i = 0; i < 3 + id % 5; ++i) {
+		text += words[(id * 7 + i * i * 3) % words.size()] + " and "s;
+	}
+	return text;
+}
+
+const std::vector<std::string> TEST_QUERIES = { "cat"s, "cat dog"s, "funny pet -rat"s, "curly hair tail big"s,
+	"small collar -cat -dog"s, "unknown"s, "nasty in -unknown"s };
+
+SearchServer MakeTestSearchServer() {
+	SearchServer search_server("and with in"s);
+	for (int id = 0; id < 60; ++id) {
+		search_server.AddDocument(id, MakeTestDocument(id), static_cast<DocumentStatus>(id % 3), { id % 10, id % 4 });
+	}
+	search_server.AddDocument(60, "and with"s, DocumentStatus::ACTUAL, {});
+	search_server.RemoveDocument(7);
+	return search_server;
+}
+
+std::string GetSnapshotPath() {
+	return (std::filesystem::temp_directory_path() / "search_server_test.snapshot").string();
+}
+
+}  // namespace
+
+void TestMaxScoreMatchesExhaustive() {
+	SearchServer search_server = MakeTestSearchServer();
+	const auto& queries = TEST_QUERIES;
+	const auto has_even_id = [](int document_id, DocumentStatus, int) {
+		return document_id % 2 == 0;
+	};
+	for (const std::string& query : queries) {
+		for (const size_t result_count : { 0, 1, 2, 5, 100 }) {
+			const std::string hint = "query \""s + query + "\", result count "s + std::to_string(result_count);
+			search_server.SetTopDocumentsMode(TopDocumentsMode::EXHAUSTIVE);
+			const auto exhaustive = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, result_count);
+			const auto exhaustive_filtered = search_server.FindTopDocuments(query, has_even_id, result_count);
+			search_server.SetTopDocumentsMode(TopDocumentsMode::MAX_SCORE);
+			const auto max_score = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, result_count);
+			const auto max_score_filtered = search_server.FindTopDocuments(query, has_even_id, result_count);
+
+			ASSERT_HINT(exhaustive.size() <= result_count, hint);
+			for (const auto& [expected, found] : { std::pair{ &exhaustive, &max_score },
+				std::pair{ &exhaustive_filtered, &max_score_filtered } }) {
+				ASSERT_HINT(found->size() == expected->size(), hint);
+				for (size_t i = 0; i < expected->size(); ++i) {
+					ASSERT_HINT((*found)[i].id == (*expected)[i].id, hint);
+					ASSERT_HINT(std::abs((*found)[i].relevance - (*expected)[i].relevance) < ACCURACY, hint);
+				}
+			}
+		}
+	}
+	search_server.SetTopDocumentsMode(TopDocumentsMode::EXHAUSTIVE);
+}
+
+void TestSnapshotRoundTrip() {
+	const std::string path = GetSnapshotPath();
+	for (const IndexMode mode : { IndexMode::PLAIN, IndexMode::COMPRESSED }) {
+		SearchServer search_server = MakeTestSearchServer();
+		search_server.SetIndexMode(mode);
+		search_server.SaveSnapshot(path);
+		const SearchServer loaded = SearchServer::LoadSnapshot(path);
+		const std::string mode_hint = mode == IndexMode::PLAIN ? "plain"s : "compressed"s;
+
+		ASSERT_HINT(loaded.GetIndexMode() == mode, mode_hint);
+		ASSERT_HINT(loaded.GetDocumentCount() == search_server.GetDocumentCount(), mode_hint);
+		ASSERT_HINT(!loaded.HasDocument(7), mode_hint);
+		for (const auto& [document_id, unused] : search_server) {
+			const auto expected = search_server.GetWordFrequencies(document_id);
+			const auto found = loaded.GetWordFrequencies(document_id);
+			ASSERT_HINT(std::equal(expected.begin(), expected.end(), found.begin(), found.end()),
+				mode_hint + " document "s + std::to_string(document_id));
+		}
+		for (const std::string& query : TEST_QUERIES) {
+			const std::string hint = mode_hint + " query \""s + query + "\""s;
+			const auto expected = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL);
+			const auto found = loaded.FindTopDocuments(query, DocumentStatus::ACTUAL);
+			ASSERT_HINT(found.size() == expected.size(), hint);
+			for (size_t i = 0; i < expected.size(); ++i) {
+				ASSERT_HINT(found[i].id == expected[i].id, hint);
+				ASSERT_HINT(found[i].rating == expected[i].rating, hint);
+				ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < ACCURACY, hint);
+			}
+		}
+	}
+	std::remove(path.c_str());
+}
+
+void TestCorruptedSnapshotIsRejected() {
+	const std::string path = GetSnapshotPath();
+	MakeTestSearchServer().SaveSnapshot(path);
+	std::string bytes;
+	{
+		std::ifstream in(path, std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	const auto write_file = [&path](const std::string& content) {
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(content.data(), content.size());
+	};
+	const auto is_rejected = [&path] {
+		try {
+			SearchServer::LoadSnapshot(path);
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	};
+
+	// The checksum covers every payload byte: the last, a middle one and the first after the 32-byte header
+	for (const size_t position : { bytes.size() - 1, bytes.size() / 2, size_t{ 32 } }) {
+		std::string corrupted = bytes;
+		corrupted[position] ^= 0x5A;
+		write_file(corrupted);
+		ASSERT_HINT(is_rejected(), "byte "s + std::to_string(position) + " changed"s);
+	}
+	write_file(bytes.substr(0, bytes.size() - 1));
+	ASSERT_HINT(is_rejected(), "truncated"s);
+	write_file(bytes);
+	ASSERT_HINT(!is_rejected(), "intact"s);
+	std::remove(path.c_str());
+}
+
+void TestSegmentedSearchServerMatchesSearchServer() {
+	const size_t write_segment_capacity = 8;
+	const int document_count = 200;
+	SegmentedSearchServer segmented("and with in"s, write_segment_capacity, 2);
+	SearchServer expected("and with in"s);
+	const auto add_document = [&](int id, const std::string& text) {
+		segmented.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id % 10 });
+		expected.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id % 10 });
+	};
+	const auto remove_document = [&](int id) {
+		segmented.RemoveDocument(id);
+		expected.RemoveDocument(id);
+	};
+	for (int id = 0; id < document_count; ++id) {
+		add_document(id, MakeTestDocument(id));
+	}
+	segmented.Flush();
+	segmented.Compact();
+	ASSERT_HINT(segmented.GetSegmentCount() < static_cast<size_t>(document_count) / write_segment_capacity, "segments are merged"s);
+	for (const std::string& query : TEST_QUERIES) {
+		const auto found = segmented.FindTopDocuments(query);
+		const auto expected_documents = expected.FindTopDocuments(query);
+		ASSERT_HINT(found.size() == expected_documents.size(), query);
+		for (size_t i = 0; i < found.size(); ++i) {
+			ASSERT_HINT(found[i].id == expected_documents[i].id, query);
+			ASSERT_HINT(std::abs(found[i].relevance - expected_documents[i].relevance) < ACCURACY, query);
+		}
+	}
+
+	// Removed before the next merges, one id is added again at once with another text
+	for (int id = 0; id < document_count; id += 7) {
+		remove_document(id);
+	}
+	add_document(14, "funny curly collar"s);
+	const int last_id = document_count * 10;
+	for (int id = document_count; id < last_id; ++id) {
+		add_document(id, MakeTestDocument(id));
+	}
+	segmented.Flush();
+	// Removed while merging, for as long as the merges run
+	std::atomic<bool> compacted = false;
+	std::thread compaction([&] {
+		segmented.Compact();
+		compacted = true;
+		});
+	for (int id = 3; id < last_id && !compacted; id += 11) {
+		remove_document(id);
+	}
+	compaction.join();
+	segmented.Compact();
+
+	// Removed documents count for IDF until their segment is merged or rewritten, so only the matched
+	// documents are compared here, not their relevance
+	ASSERT_HINT(segmented.GetDocumentCount() == expected.GetDocumentCount(), "document count"s);
+	const auto any_document = [](int, DocumentStatus, int) {
+		return true;
+	};
+	for (const std::string& query : TEST_QUERIES) {
+		std::set<std::pair<int, int>> found;
+		for (const Document& document : segmented.FindTopDocuments(query, any_document, last_id)) {
+			found.emplace(document.id, document.rating);
+		}
+		std::set<std::pair<int, int>> expected_documents;
+		for (const Document& document : expected.FindTopDocuments(query, any_document, last_id)) {
+			expected_documents.emplace(document.id, document.rating);
+		}
+		ASSERT_HINT(found == expected_documents, query);
+	}
+}
+
+void TestSearchServer() {
+	TestMaxScoreMatchesExhaustive();
+	TestSnapshotRoundTrip();
+	TestCorruptedSnapshotIsRejected();
+	TestSegmentedSearchServerMatchesSearchServer();
+}
@@ -1,3 +1,17 @@
 #pragma once
 
+// Runs every test below, aborts with a message on the first failed check
+void TestSearchServer();
 
+// Sequential MaxScore search returns the same documents as exhaustive scoring, for any result count
+void TestMaxScoreMatchesExhaustive();
+
+// A snapshot loads back into an equal server in both index modes, removed documents included
+void TestSnapshotRoundTrip();
+
+// Loading a snapshot with a changed or missing byte throws std::runtime_error
+void TestCorruptedSnapshotIsRejected();
+
+// SegmentedSearchServer finds the documents a SearchServer holding the same ones finds, with removals
+// made before and while merging and removed ids added again
+void TestSegmentedSearchServerMatchesSearchServer();
@@ -0,0 +1,27 @@
+#include "top_documents.h"
+
+TopDocumentsCollector::TopDocumentsCollector(size_t capacity, size_t candidate_count)
+	: capacity_(capacity) {
+	heap_.reserve(std::min(capacity, candidate_count));
+}
+
+void TopDocumentsCollector::Push(const Document& document) {
+	if (capacity_ == 0) {
+		return;
+	}
+	if (!IsFull()) {
+		heap_.push_back(document);
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		return;
+	}
+	if (IsMoreRelevant(document, heap_.front())) {
+		std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		heap_.back() = document;
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+}
+
+std::vector<Document> TopDocumentsCollector::Extract() {
+	std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	return std::move(heap_);
+}
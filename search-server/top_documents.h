@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "document.h"
+
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const double ACCURACY = 1e-6;
+
+// Result order: relevance, then rating if relevances are equal within ACCURACY, then document id
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (std::abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+		return lhs.relevance > rhs.relevance;
+	}
+	if (lhs.rating != rhs.rating) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.id < rhs.id;
+}
+
+// Leaves the best result_count documents sorted by relevance without sorting the rest
+template <typename ExecutionPolicy>
+void SelectTopDocuments(ExecutionPolicy&& policy, std::vector<Document>& documents, size_t result_count) {
+	if (documents.size() > result_count) {
+		std::partial_sort(policy, documents.begin(), documents.begin() + result_count, documents.end(),
+			IsMoreRelevant);
+		documents.resize(result_count);
+	}
+	else {
+		std::sort(policy, documents.begin(), documents.end(), IsMoreRelevant);
+	}
+}
+
+// Bounded heap keeping the best documents seen so far
+class TopDocumentsCollector {
+public:
+	// Memory is reserved for at most candidate_count documents, however large the capacity is
+	TopDocumentsCollector(size_t capacity, size_t candidate_count);
+
+	void Push(const Document& document);
+
+	// Never true for capacity 0, which keeps no document to compare with
+	bool IsFull() const {
+		return !heap_.empty() && heap_.size() == capacity_;
+	}
+
+	// Relevance of the weakest kept document, meaningful only when full
+	double GetThreshold() const {
+		return heap_.front().relevance;
+	}
+
+	// Returns the kept documents best first and empties the collector
+	std::vector<Document> Extract();
+
+private:
+	size_t capacity_;
+	// With IsMoreRelevant as "less" the heap top is the weakest document
+	std::vector<Document> heap_;
+};
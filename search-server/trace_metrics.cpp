@@ -0,0 +1,225 @@
+#include "trace_metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+std::atomic<uint32_t> trace_sample_period{ 1 };
+
+namespace {
+
+struct TraceRegistry {
+	std::mutex mutex;
+	std::vector<std::string> names;
+	std::vector<std::unique_ptr<ThreadTraceMetrics>> threads;
+	// Slots of exited threads, zeroed and ready for reuse
+	std::vector<ThreadTraceMetrics*> free_threads;
+	// Counters of exited threads
+	ThreadTraceMetrics retired;
+};
+
+// Leaked, so that threads exiting after main still find it
+TraceRegistry& GetTraceRegistry() {
+	static TraceRegistry* const registry = new TraceRegistry;
+	return *registry;
+}
+
+const uint64_t SUB_BUCKET_COUNT = uint64_t{ 1 } << TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+
+uint64_t GetBucketUpperBound(size_t bucket) {
+	if (bucket < SUB_BUCKET_COUNT) {
+		return bucket + 1;
+	}
+	const size_t exponent = bucket / SUB_BUCKET_COUNT + TRACE_HISTOGRAM_SUB_BUCKET_BITS - 1;
+	const uint64_t mantissa = SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT;
+	return (mantissa + 1) << (exponent - TRACE_HISTOGRAM_SUB_BUCKET_BITS);
+}
+
+void ResetCounters(ThreadTraceMetrics::Counters& counters) {
+	counters.calls.store(0, std::memory_order_relaxed);
+	counters.sampled_calls.store(0, std::memory_order_relaxed);
+	counters.total_nanoseconds.store(0, std::memory_order_relaxed);
+	counters.max_nanoseconds.store(0, std::memory_order_relaxed);
+	for (auto& bucket : counters.histogram) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+// Called with the registry mutex held by the owner of counters, so neither side is written meanwhile
+void AddCounters(ThreadTraceMetrics::Counters& sum, const ThreadTraceMetrics::Counters& counters) {
+	const auto add = [](std::atomic<uint64_t>& total, const std::atomic<uint64_t>& value) {
+		total.store(total.load(std::memory_order_relaxed) + value.load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	};
+	add(sum.calls, counters.calls);
+	add(sum.sampled_calls, counters.sampled_calls);
+	add(sum.total_nanoseconds, counters.total_nanoseconds);
+	sum.max_nanoseconds.store(std::max(sum.max_nanoseconds.load(std::memory_order_relaxed),
+		counters.max_nanoseconds.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+	for (size_t bucket = 0; bucket < TRACE_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+		add(sum.histogram[bucket], counters.histogram[bucket]);
+	}
+}
+
+void PrintJsonString(std::ostream& out, const std::string& text) {
+	out << '"';
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			out << '\\';
+		}
+		out << c;
+	}
+	out << '"';
+}
+
+}  // namespace
+
+TraceMetricId RegisterTraceMetric(const std::string& name) {
+	TraceRegistry& registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	const auto position = std::find(registry.names.begin(), registry.names.end(), name);
+	if (position != registry.names.end()) {
+		return static_cast<TraceMetricId>(position - registry.names.begin());
+	}
+	if (registry.names.size() == MAX_TRACE_METRIC_COUNT) {
+		throw std::length_error("Too many trace metrics");
+	}
+	registry.names.push_back(name);
+	return static_cast<TraceMetricId>(registry.names.size() - 1);
+}
+
+ThreadTraceMetrics& RegisterTraceThread() {
+	TraceRegistry& registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	if (!registry.free_threads.empty()) {
+		ThreadTraceMetrics& thread_metrics = *registry.free_threads.back();
+		registry.free_threads.pop_back();
+		return thread_metrics;
+	}
+	registry.threads.push_back(std::make_unique<ThreadTraceMetrics>());
+	return *registry.threads.back();
+}
+
+void RetireTraceThread(ThreadTraceMetrics& thread_metrics) {
+	TraceRegistry& registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	for (size_t id = 0; id < MAX_TRACE_METRIC_COUNT; ++id) {
+		AddCounters(registry.retired.metrics[id], thread_metrics.metrics[id]);
+		ResetCounters(thread_metrics.metrics[id]);
+	}
+	registry.free_threads.push_back(&thread_metrics);
+}
+
+void SetTraceSamplePeriod(uint32_t period) {
+	trace_sample_period.store(std::max<uint32_t>(period, 1), std::memory_order_relaxed);
+}
+
+size_t GetTraceHistogramBucket(uint64_t nanoseconds) {
+	if (nanoseconds < SUB_BUCKET_COUNT) {
+		return nanoseconds;
+	}
+	size_t exponent = 0;
+	for (uint64_t value = nanoseconds; value > 1; value >>= 1) {
+		++exponent;
+	}
+	const uint64_t mantissa = (nanoseconds >> (exponent - TRACE_HISTOGRAM_SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+	const size_t bucket = (exponent - TRACE_HISTOGRAM_SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + mantissa;
+	return std::min(bucket, TRACE_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+double TraceMetric::GetMeanNanoseconds() const {
+	return sampled_calls > 0 ? static_cast<double>(total_nanoseconds) / sampled_calls : 0.0;
+}
+
+uint64_t TraceMetric::GetQuantileNanoseconds(double quantile) const {
+	if (sampled_calls == 0) {
+		return 0;
+	}
+	const double rank = std::clamp(quantile, 0.0, 1.0) * sampled_calls;
+	uint64_t count = 0;
+	for (size_t bucket = 0; bucket < histogram.size(); ++bucket) {
+		count += histogram[bucket];
+		if (count > 0 && count >= rank) {
+			return std::min(GetBucketUpperBound(bucket), max_nanoseconds);
+		}
+	}
+	return max_nanoseconds;
+}
+
+std::vector<TraceMetric> CollectTraceMetrics() {
+	TraceRegistry& registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	std::vector<TraceMetric> result;
+	std::vector<const ThreadTraceMetrics*> threads = { &registry.retired };
+	for (const auto& thread_metrics : registry.threads) {
+		threads.push_back(thread_metrics.get());
+	}
+	for (size_t id = 0; id < registry.names.size(); ++id) {
+		TraceMetric metric{ registry.names[id], 0, 0, 0, 0, std::vector<uint64_t>(TRACE_HISTOGRAM_BUCKET_COUNT) };
+		for (const ThreadTraceMetrics* thread_metrics : threads) {
+			const ThreadTraceMetrics::Counters& counters = thread_metrics->metrics[id];
+			metric.calls += counters.calls.load(std::memory_order_relaxed);
+			metric.sampled_calls += counters.sampled_calls.load(std::memory_order_relaxed);
+			metric.total_nanoseconds += counters.total_nanoseconds.load(std::memory_order_relaxed);
+			metric.max_nanoseconds = std::max(metric.max_nanoseconds,
+				counters.max_nanoseconds.load(std::memory_order_relaxed));
+			for (size_t bucket = 0; bucket < TRACE_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+				metric.histogram[bucket] += counters.histogram[bucket].load(std::memory_order_relaxed);
+			}
+		}
+		if (metric.calls > 0) {
+			result.push_back(std::move(metric));
+		}
+	}
+	return result;
+}
+
+void PrintTraceMetrics(std::ostream& out) {
+	out << std::left << std::setw(28) << "scope" << std::right << std::setw(12) << "calls"
+		<< std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns"
+		<< std::setw(14) << "max ns" << std::setw(16) << "total ms" << '\n';
+	for (const TraceMetric& metric : CollectTraceMetrics()) {
+		// Totals of sampled scopes are scaled up to all calls
+		const double total_milliseconds = metric.GetMeanNanoseconds() * metric.calls / 1e6;
+		out << std::left << std::setw(28) << metric.name << std::right << std::setw(12) << metric.calls
+			<< std::setw(12) << static_cast<uint64_t>(metric.GetMeanNanoseconds())
+			<< std::setw(12) << metric.GetQuantileNanoseconds(0.5) << std::setw(12) << metric.GetQuantileNanoseconds(0.99)
+			<< std::setw(14) << metric.max_nanoseconds
+			<< std::setw(16) << std::fixed << std::setprecision(3) << total_milliseconds << '\n';
+	}
+}
+
+void PrintTraceMetricsJson(std::ostream& out) {
+	out << '[';
+	bool first = true;
+	for (const TraceMetric& metric : CollectTraceMetrics()) {
+		if (!first) {
+			out << ',';
+		}
+		first = false;
+		out << "{\"name\":";
+		PrintJsonString(out, metric.name);
+		out << ",\"calls\":" << metric.calls << ",\"sampled_calls\":" << metric.sampled_calls
+			<< ",\"mean_ns\":" << static_cast<uint64_t>(metric.GetMeanNanoseconds())
+			<< ",\"p50_ns\":" << metric.GetQuantileNanoseconds(0.5)
+			<< ",\"p90_ns\":" << metric.GetQuantileNanoseconds(0.9)
+			<< ",\"p99_ns\":" << metric.GetQuantileNanoseconds(0.99)
+			<< ",\"max_ns\":" << metric.max_nanoseconds << '}';
+	}
+	out << "]\n";
+}
+
+void ResetTraceMetrics() {
+	TraceRegistry& registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	for (const auto& thread_metrics : registry.threads) {
+		for (ThreadTraceMetrics::Counters& counters : thread_metrics->metrics) {
+			ResetCounters(counters);
+		}
+	}
+	for (ThreadTraceMetrics::Counters& counters : registry.retired.metrics) {
+		ResetCounters(counters);
+	}
+}
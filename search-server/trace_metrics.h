@@ -0,0 +1,151 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Named scopes timed with nanosecond resolution. Every thread counts into its own slots, so a scope costs
+// two clock reads and a few uncontended stores. Dumps merge the slots of all threads that ever traced:
+// an exiting thread folds its counters into retired totals and frees its slot for the next thread.
+// Define SEARCH_SERVER_NO_TRACING to compile the scopes out.
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_NO_TRACING
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) \
+	static const TraceMetricId TRACE_CONCAT(trace_metric_, __LINE__) = RegisterTraceMetric(name); \
+	const TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(TRACE_CONCAT(trace_metric_, __LINE__))
+#endif
+
+using TraceMetricId = uint32_t;
+
+const size_t MAX_TRACE_METRIC_COUNT = 64;
+// Log-linear histogram: 8 buckets per power of two of nanoseconds, up to 2^40 ns
+const size_t TRACE_HISTOGRAM_SUB_BUCKET_BITS = 3;
+const size_t TRACE_HISTOGRAM_BUCKET_COUNT = (41 - TRACE_HISTOGRAM_SUB_BUCKET_BITS) << TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+
+// Returns the same id for the same name. Throws std::length_error past MAX_TRACE_METRIC_COUNT names.
+TraceMetricId RegisterTraceMetric(const std::string& name);
+
+// Only every period-th call of a scope in a thread reads the clock, the rest are just counted. 1 times every call.
+void SetTraceSamplePeriod(uint32_t period);
+
+struct TraceMetric {
+	std::string name;
+	uint64_t calls = 0;
+	uint64_t sampled_calls = 0;
+	uint64_t total_nanoseconds = 0;
+	uint64_t max_nanoseconds = 0;
+	std::vector<uint64_t> histogram;
+
+	double GetMeanNanoseconds() const;
+
+	// Upper bound of the histogram bucket holding the quantile of sampled durations
+	uint64_t GetQuantileNanoseconds(double quantile) const;
+};
+
+// Metrics with at least one call, in registration order
+std::vector<TraceMetric> CollectTraceMetrics();
+
+void PrintTraceMetrics(std::ostream& out);
+
+void PrintTraceMetricsJson(std::ostream& out);
+
+// Must not run concurrently with traced code
+void ResetTraceMetrics();
+
+size_t GetTraceHistogramBucket(uint64_t nanoseconds);
+
+// Counters of one thread. Only the owner thread writes them, dumps read them concurrently.
+struct ThreadTraceMetrics {
+	struct Counters {
+		std::atomic<uint64_t> calls{ 0 };
+		std::atomic<uint64_t> sampled_calls{ 0 };
+		std::atomic<uint64_t> total_nanoseconds{ 0 };
+		std::atomic<uint64_t> max_nanoseconds{ 0 };
+		std::array<std::atomic<uint64_t>, TRACE_HISTOGRAM_BUCKET_COUNT> histogram{};
+	};
+
+	std::array<Counters, MAX_TRACE_METRIC_COUNT> metrics;
+};
+
+// Takes zeroed counters for the calling thread, reusing the slot of an exited thread if there is one
+ThreadTraceMetrics& RegisterTraceThread();
+
+// Adds the counters to the retired totals, zeroes them and frees the slot
+void RetireTraceThread(ThreadTraceMetrics& thread_metrics);
+
+// Holds the slot of a thread for its lifetime
+class ThreadTraceSlot {
+public:
+	ThreadTraceSlot()
+		: metrics(RegisterTraceThread()) {
+	}
+
+	ThreadTraceSlot(const ThreadTraceSlot&) = delete;
+	ThreadTraceSlot& operator=(const ThreadTraceSlot&) = delete;
+
+	~ThreadTraceSlot() {
+		RetireTraceThread(metrics);
+	}
+
+	ThreadTraceMetrics& metrics;
+};
+
+inline ThreadTraceMetrics& GetThreadTraceMetrics() {
+	thread_local ThreadTraceSlot slot;
+	return slot.metrics;
+}
+
+extern std::atomic<uint32_t> trace_sample_period;
+
+class TraceScope {
+public:
+	explicit TraceScope(TraceMetricId id)
+		: TraceScope(GetThreadTraceMetrics(), id) {
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	~TraceScope() {
+		if (!sampled_) {
+			return;
+		}
+		const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start_time_).count();
+		Increase(counters_.sampled_calls, 1);
+		Increase(counters_.total_nanoseconds, nanoseconds);
+		if (nanoseconds > counters_.max_nanoseconds.load(std::memory_order_relaxed)) {
+			counters_.max_nanoseconds.store(nanoseconds, std::memory_order_relaxed);
+		}
+		Increase(counters_.histogram[GetTraceHistogramBucket(nanoseconds)], 1);
+	}
+
+private:
+	ThreadTraceMetrics::Counters& counters_;
+	bool sampled_ = false;
+	std::chrono::steady_clock::time_point start_time_;
+
+	TraceScope(ThreadTraceMetrics& thread_metrics, TraceMetricId id)
+		: counters_(thread_metrics.metrics[id]) {
+		const uint64_t calls = Increase(counters_.calls, 1);
+		const uint32_t period = trace_sample_period.load(std::memory_order_relaxed);
+		sampled_ = period <= 1 || calls % period == 0;
+		if (sampled_) {
+			start_time_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	// The owner thread is the only writer, so no read-modify-write is needed
+	static uint64_t Increase(std::atomic<uint64_t>& counter, uint64_t value) {
+		const uint64_t result = counter.load(std::memory_order_relaxed) + value;
+		counter.store(result, std::memory_order_relaxed);
+		return result;
+	}
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Read-copy-update holder of an immutable value. Readers pin the current version with Load and keep
+// using it while writers publish new versions. A version is freed once its last reader releases it.
+// Load and Publish use the atomic shared_ptr functions, which libstdc++ implements with a small pool of
+// mutexes: a reader may wait for another thread's pointer copy, but never for an update to be built.
+// Update copies the whole value, so T should be small, e.g. a list of pointers to shared parts.
+template <typename T>
+class VersionedPtr {
+public:
+	explicit VersionedPtr(std::shared_ptr<const T> value)
+		: current_(std::move(value)) {
+	}
+
+	std::shared_ptr<const T> Load() const {
+		return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+	}
+
+	// Number of versions published after the initial one
+	uint64_t GetEpoch() const {
+		return epoch_.load(std::memory_order_acquire);
+	}
+
+	// Lets updater change a private copy of the current version, then publishes the copy.
+	// Writers are serialized. If updater throws, nothing is published.
+	template <typename Updater>
+	void Update(Updater updater) {
+		std::lock_guard<std::mutex> guard(write_mutex_);
+		auto next = std::make_shared<T>(*Load());
+		updater(*next);
+		Publish(std::move(next));
+	}
+
+	// Publishes a version built by the caller, writers are serialized with Update
+	template <typename Builder>
+	void Replace(Builder builder) {
+		std::lock_guard<std::mutex> guard(write_mutex_);
+		Publish(builder(Load()));
+	}
+
+private:
+	std::shared_ptr<const T> current_;
+	std::atomic<uint64_t> epoch_ = 0;
+	std::mutex write_mutex_;
+
+	void Publish(std::shared_ptr<const T> next) {
+		std::atomic_store_explicit(&current_, std::move(next), std::memory_order_release);
+		epoch_.fetch_add(1, std::memory_order_acq_rel);
+	}
+};